@@ -0,0 +1,113 @@
+﻿// 并行算法性能对比：std串行版本 / std::execution::par / 基于ThreadPool的parallel_xxx
+// 定义BENCH_WITH_STD_EXECUTION后才编译std::execution::par版本(libstdc++需要链接TBB)
+// 用法: bench_parallel_algorithm [元素个数] [线程数]
+// 编译: g++ -O2 -std=c++17 -I../thread_pool_refactor bench_parallel_algorithm.cpp -pthread
+//       加上 -DBENCH_WITH_STD_EXECUTION -ltbb 对比std::execution::par
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <cstdlib>
+
+#ifdef BENCH_WITH_STD_EXECUTION
+#include <execution>
+#endif
+
+#include "parallel_algorithm.h"
+
+using namespace std;
+
+const int BENCH_REPEAT = 5; // 每项重复次数 取最好成绩
+
+volatile size_t sink; // 保存结果 防止被优化掉
+
+// 运行prepare + func若干次，返回func最短耗时(毫秒)，prepare不计时
+template<typename Prepare, typename Func>
+double bench(Prepare prepare, Func func)
+{
+	double best = 1e30;
+	for (int i = 0; i < BENCH_REPEAT; i++) {
+		prepare();
+		auto begin = chrono::steady_clock::now();
+		func();
+		auto end = chrono::steady_clock::now();
+		best = min(best, chrono::duration<double, milli>(end - begin).count());
+	}
+	return best;
+}
+
+void report(const string& algo, const string& impl, double ms, double baseMs)
+{
+	cout << left << setw(16) << algo << setw(14) << impl
+		<< right << setw(10) << fixed << setprecision(2) << ms << " ms"
+		<< setw(9) << setprecision(2) << baseMs / ms << "x" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10000000;
+	int threads = argc > 2 ? atoi(argv[2]) : (int)thread::hardware_concurrency();
+	if (threads <= 0) {
+		threads = 4;
+	}
+
+	ThreadPool pool;
+	pool.start(threads);
+
+	cout << "n = " << n << ", threads = " << threads << endl;
+
+	mt19937_64 rng(42);
+	vector<long long> input(n);
+	for (auto& x : input) {
+		x = (long long)(rng() % 1000000);
+	}
+	vector<long long> data(n), out(n);
+	auto copyInput = [&]() { data = input; };
+	auto nothing = []() {};
+
+	// sort
+	double base = bench(copyInput, [&]() { sort(data.begin(), data.end()); });
+	report("sort", "std", base, base);
+#ifdef BENCH_WITH_STD_EXECUTION
+	report("sort", "std::par", bench(copyInput, [&]() { sort(execution::par, data.begin(), data.end()); }), base);
+#endif
+	report("sort", "pool", bench(copyInput, [&]() { parallel_sort(pool, data.begin(), data.end()); }), base);
+
+	// inclusive_scan
+	base = bench(nothing, [&]() { inclusive_scan(input.begin(), input.end(), out.begin()); });
+	report("inclusive_scan", "std", base, base);
+#ifdef BENCH_WITH_STD_EXECUTION
+	report("inclusive_scan", "std::par", bench(nothing, [&]() { inclusive_scan(execution::par, input.begin(), input.end(), out.begin()); }), base);
+#endif
+	report("inclusive_scan", "pool", bench(nothing, [&]() { parallel_inclusive_scan(pool, input.begin(), input.end(), out.begin()); }), base);
+
+	// transform 每个元素做一点计算，避免纯粹测内存带宽
+	auto op = [](long long x) { return (x * 2654435761LL) ^ (x >> 7); };
+	base = bench(nothing, [&]() { transform(input.begin(), input.end(), out.begin(), op); });
+	report("transform", "std", base, base);
+#ifdef BENCH_WITH_STD_EXECUTION
+	report("transform", "std::par", bench(nothing, [&]() { transform(execution::par, input.begin(), input.end(), out.begin(), op); }), base);
+#endif
+	report("transform", "pool", bench(nothing, [&]() { parallel_transform(pool, input.begin(), input.end(), out.begin(), op); }), base);
+
+	// find_if 目标放在3/4处，测试提前退出
+	vector<long long> haystack(n, 0);
+	if (n > 0) {
+		haystack[n / 4 * 3] = 1;
+	}
+	auto pred = [](long long x) { return x == 1; };
+	base = bench(nothing, [&]() { sink = find_if(haystack.begin(), haystack.end(), pred) - haystack.begin(); });
+	report("find_if", "std", base, base);
+#ifdef BENCH_WITH_STD_EXECUTION
+	report("find_if", "std::par", bench(nothing, [&]() { sink = find_if(execution::par, haystack.begin(), haystack.end(), pred) - haystack.begin(); }), base);
+#endif
+	report("find_if", "pool", bench(nothing, [&]() { sink = parallel_find_if(pool, haystack.begin(), haystack.end(), pred) - haystack.begin(); }), base);
+
+	return 0;
+}
@@ -0,0 +1,127 @@
+﻿// 流水线吞吐量对比：串行循环 / 基于ThreadPool的Pipeline / tbb::parallel_pipeline
+// 流水线为 source(有序) -> 计算(并行) -> 汇总(有序)，分别测试每个数据计算量很小和较大两种情况
+// 定义BENCH_WITH_TBB后才编译tbb::parallel_pipeline版本
+// 用法: bench_pipeline [数据个数] [线程数] [令牌数]
+// 编译: g++ -O2 -std=c++17 -I../thread_pool_refactor bench_pipeline.cpp -pthread
+//       加上 -DBENCH_WITH_TBB -ltbb 对比tbb::parallel_pipeline
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+#ifdef BENCH_WITH_TBB
+#include <tbb/parallel_pipeline.h>
+#include <tbb/task_arena.h>
+#endif
+
+#include "pipeline.h"
+
+using namespace std;
+
+const int BENCH_REPEAT = 5; // 每项重复次数 取最好成绩
+
+volatile uint64_t sink; // 保存结果 防止被优化掉
+
+// 运行func若干次，返回最短耗时(毫秒)
+template<typename Func>
+double bench(Func func)
+{
+	double best = 1e30;
+	for (int i = 0; i < BENCH_REPEAT; i++) {
+		auto begin = chrono::steady_clock::now();
+		func();
+		auto end = chrono::steady_clock::now();
+		best = min(best, chrono::duration<double, milli>(end - begin).count());
+	}
+	return best;
+}
+
+void report(const string& load, const string& impl, size_t n, double ms, double baseMs)
+{
+	cout << left << setw(8) << load << setw(10) << impl
+		<< right << setw(10) << fixed << setprecision(2) << ms << " ms"
+		<< setw(12) << setprecision(0) << n / ms * 1000.0 << " items/s"
+		<< setw(9) << setprecision(2) << baseMs / ms << "x" << endl;
+}
+
+// 每个数据的计算 rounds次乘法和移位
+uint64_t work(uint64_t x, int rounds)
+{
+	for (int i = 0; i < rounds; i++) {
+		x = (x * 2654435761ULL) ^ (x >> 7);
+	}
+	return x;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 200000;
+	int threads = argc > 2 ? atoi(argv[2]) : (int)thread::hardware_concurrency();
+	if (threads <= 0) {
+		threads = 4;
+	}
+	size_t tokens = argc > 3 ? strtoull(argv[3], nullptr, 10) : (size_t)threads * 4;
+
+	ThreadPool pool;
+	pool.start(threads);
+#ifdef BENCH_WITH_TBB
+	tbb::task_arena arena(threads);
+#endif
+
+	cout << "n = " << n << ", threads = " << threads << ", tokens = " << tokens << endl;
+
+	// light每个数据只有几十纳秒的计算，测的是每个数据的调度开销；heavy的计算量远大于调度开销
+	const pair<const char*, int> loads[] = { { "light", 16 }, { "heavy", 4096 } };
+	for (auto& load : loads) {
+		int rounds = load.second;
+
+		double base = bench([&]() {
+			uint64_t sum = 0;
+			for (size_t i = 0; i < n; i++) {
+				sum += work(i, rounds);
+			}
+			sink = sum;
+			});
+		report(load.first, "serial", n, base, base);
+
+		report(load.first, "pool", n, bench([&]() {
+			uint64_t next = 0;
+			uint64_t sum = 0;
+			Pipeline pipeline(pool, tokens);
+			pipeline.addStage<uint64_t>(STAGE_PARALLEL, [rounds](uint64_t x) { return work(x, rounds); })
+				.addStage<uint64_t>(STAGE_SERIAL_IN_ORDER, [&sum](uint64_t x) { sum += x; });
+			pipeline.run([&](FlowControl& fc) -> uint64_t {
+				if (next == n) {
+					fc.stop();
+				}
+				return next++;
+				});
+			sink = sum;
+			}), base);
+
+#ifdef BENCH_WITH_TBB
+		report(load.first, "tbb", n, bench([&]() {
+			uint64_t next = 0;
+			uint64_t sum = 0;
+			arena.execute([&]() {
+				tbb::parallel_pipeline(tokens,
+					tbb::make_filter<void, uint64_t>(tbb::filter_mode::serial_in_order, [&](tbb::flow_control& fc) -> uint64_t {
+						if (next == n) {
+							fc.stop();
+						}
+						return next++;
+						})
+					& tbb::make_filter<uint64_t, uint64_t>(tbb::filter_mode::parallel, [rounds](uint64_t x) { return work(x, rounds); })
+					& tbb::make_filter<uint64_t, void>(tbb::filter_mode::serial_in_order, [&sum](uint64_t x) { sum += x; }));
+				});
+			sink = sum;
+			}), base);
+#endif
+	}
+
+	return 0;
+}
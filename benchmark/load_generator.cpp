@@ -0,0 +1,586 @@
+﻿// 开环负载生成器：按指定的到达过程和服务时间分布向线程池提交任务，统计负载下的延迟分布
+// 开环：请求按计划时刻发出，不等之前的请求完成，线程池变慢时请求照样到达，排队时间如实计入延迟
+// 延迟从"计划发出时刻"算起(修正协调遗漏 coordinated omission)，提交线程被阻塞、睡过头的时间也算在内
+// 同时给出从实际提交时刻算起的未修正延迟，两者相差越大说明提交端被拖慢得越厉害
+// 用法: load_generator [--选项=值 ...]   --help 查看所有选项
+// 例:   load_generator --mode=fixed,cached --arrival=bursty --utilization=0.8 --format=csv --output=result.csv
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <map>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+
+#include "thread_pool_refactor.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+const int HIST_SUB_BUCKET_BITS = 5; // 每个2的幂区间等分为32个子桶，相对误差约3%
+const int HIST_SUB_BUCKETS = 1 << HIST_SUB_BUCKET_BITS;
+const int HIST_BUCKETS = HIST_SUB_BUCKETS * (64 - HIST_SUB_BUCKET_BITS + 1);
+const double PERCENTILES[] = { 50, 90, 99, 99.9, 99.99 };
+
+struct Options {
+	vector<string> modes = { "fixed", "cached" }; //参与对比的线程池配置
+	int threads = 4; //初始线程数
+	int maxThreads = 64; //cached模式的线程上限
+	string arrival = "poisson"; //到达过程 uniform|poisson|bursty|diurnal
+	double rate = 0; //平均每秒请求数 0表示按utilization计算
+	double utilization = 0.8; //目标利用率 rate = utilization * threads / 平均服务时间
+	string service = "exponential"; //服务时间分布 fixed|exponential|lognormal|bimodal
+	double serviceUs = 100; //平均服务时间(微秒)
+	double serviceSigma = 1.0; //lognormal分布的sigma
+	string work = "spin"; //任务如何消耗服务时间 spin占用CPU|sleep不占用CPU
+	double burstMs = 50; //bursty: 突发期平均长度(毫秒)
+	double burstDuty = 0.2; //bursty: 突发期占总时间的比例，突发期到达率为平均值的1/burstDuty，其余时间没有请求
+	double diurnalPeriod = 10; //diurnal: 到达率正弦变化的周期(秒)
+	double diurnalAmplitude = 0.5; //diurnal: 正弦变化幅度，到达率在 rate*(1±amplitude) 之间变化
+	double duration = 10; //每种配置的运行时间(秒)
+	double warmup = 1; //开头这段时间内发出的请求不计入统计(秒)
+	string format = "text"; //输出格式 text|csv|json
+	string output; //输出文件 为空时输出到标准输出
+	uint64_t seed = 42;
+};
+
+// 一种线程池配置的运行结果
+struct RunResult {
+	string mode;
+	double offeredRps = 0; //计划到达率
+	double achievedRps = 0; //实际完成率
+	uint64_t sent = 0;
+	uint64_t completed = 0;
+	uint64_t rejected = 0;
+	uint64_t recorded = 0; //计入统计的请求数
+	double meanUs = 0;
+	vector<double> percentilesUs; //与PERCENTILES对应 修正后的延迟
+	double maxUs = 0;
+	double rawP99Us = 0; //未修正的p99 从实际提交时刻算起
+	double maxSendLagUs = 0; //实际提交时刻比计划时刻最多晚了多少
+	int peakThreads = 0; //运行期间线程数量的最大值
+};
+
+
+/////////////// 延迟直方图
+
+// 对数分桶直方图：小于32ns的值精确记录，其余值每个2的幂区间等分为HIST_SUB_BUCKETS个子桶
+// 计数都是原子变量，工作线程可以并发记录
+class LatencyHistogram {
+public:
+	LatencyHistogram() : counts_(HIST_BUCKETS), total_(0), sum_(0), max_(0) {}
+
+	void record(uint64_t ns)
+	{
+		counts_[indexOf(ns)].fetch_add(1, memory_order_relaxed);
+		total_.fetch_add(1, memory_order_relaxed);
+		sum_.fetch_add(ns, memory_order_relaxed);
+		uint64_t old = max_.load(memory_order_relaxed);
+		while (ns > old && !max_.compare_exchange_weak(old, ns, memory_order_relaxed)) {
+		}
+	}
+
+	uint64_t count() const { return total_; }
+	uint64_t max() const { return max_; }
+	double mean() const { return total_ == 0 ? 0 : (double)sum_ / total_; }
+
+	//百分位数 返回所在桶的上界，不超过最大值
+	uint64_t percentile(double p) const
+	{
+		uint64_t total = total_;
+		if (total == 0) {
+			return 0;
+		}
+		uint64_t target = (uint64_t)ceil(p / 100.0 * total);
+		target = std::max<uint64_t>(target, 1);
+
+		uint64_t seen = 0;
+		for (int i = 0; i < HIST_BUCKETS; i++) {
+			seen += counts_[i];
+			if (seen >= target) {
+				return std::min<uint64_t>(upperBound(i), max_);
+			}
+		}
+		return max_;
+	}
+
+private:
+	static int indexOf(uint64_t v)
+	{
+		if (v < (uint64_t)HIST_SUB_BUCKETS) {
+			return (int)v;
+		}
+		int exp = 63 - __builtin_clzll(v);
+		int shift = exp - HIST_SUB_BUCKET_BITS;
+		int sub = (int)(v >> shift) - HIST_SUB_BUCKETS;
+		return HIST_SUB_BUCKETS + shift * HIST_SUB_BUCKETS + sub;
+	}
+
+	static uint64_t upperBound(int index)
+	{
+		if (index < HIST_SUB_BUCKETS) {
+			return (uint64_t)index;
+		}
+		int shift = (index - HIST_SUB_BUCKETS) / HIST_SUB_BUCKETS;
+		uint64_t top = (uint64_t)(index % HIST_SUB_BUCKETS + HIST_SUB_BUCKETS);
+		return ((top + 1) << shift) - 1;
+	}
+
+private:
+	vector<atomic<uint64_t>> counts_;
+	atomic<uint64_t> total_;
+	atomic<uint64_t> sum_;
+	atomic<uint64_t> max_;
+};
+
+
+/////////////// 到达过程和服务时间
+
+// 生成请求的计划时刻(从开始算起的秒数)
+class ArrivalProcess {
+public:
+	ArrivalProcess(const Options& opt, double rate)
+		: opt_(opt)
+		, rate_(rate)
+		, now_(0)
+		, burstEnd_(0)
+	{}
+
+	double next(mt19937_64& rng)
+	{
+		if (opt_.arrival == "uniform") {
+			now_ += 1.0 / rate_;
+		}
+		else if (opt_.arrival == "poisson") {
+			now_ += exponential(rng, rate_);
+		}
+		else if (opt_.arrival == "bursty") {
+			nextBursty(rng);
+		}
+		else {
+			nextDiurnal(rng);
+		}
+		return now_;
+	}
+
+private:
+	static double exponential(mt19937_64& rng, double rate)
+	{
+		return exponential_distribution<double>(rate)(rng);
+	}
+
+	// 开关调制的泊松过程：突发期按 rate/duty 到达，静默期没有请求，两种状态的持续时间都服从指数分布，平均到达率仍为rate
+	void nextBursty(mt19937_64& rng)
+	{
+		double burstSec = opt_.burstMs / 1000.0;
+		double quietSec = burstSec * (1 - opt_.burstDuty) / opt_.burstDuty;
+		for (;;) {
+			double t = now_ + exponential(rng, rate_ / opt_.burstDuty);
+			if (t < burstEnd_) {
+				now_ = t;
+				return;
+			}
+			// 本次突发结束 跳过静默期进入下一次突发
+			now_ = burstEnd_ + exponential(rng, 1 / quietSec);
+			burstEnd_ = now_ + exponential(rng, 1 / burstSec);
+		}
+	}
+
+	// 到达率按正弦变化的非齐次泊松过程，用稀疏化(thinning)方法生成
+	void nextDiurnal(mt19937_64& rng)
+	{
+		const double pi = 3.14159265358979323846;
+		double maxRate = rate_ * (1 + opt_.diurnalAmplitude);
+		uniform_real_distribution<double> uniform(0, 1);
+		for (;;) {
+			now_ += exponential(rng, maxRate);
+			double rate = rate_ * (1 + opt_.diurnalAmplitude * sin(2 * pi * now_ / opt_.diurnalPeriod));
+			if (uniform(rng) * maxRate <= rate) {
+				return;
+			}
+		}
+	}
+
+private:
+	const Options& opt_;
+	double rate_;
+	double now_; //上一个请求的时刻
+	double burstEnd_; //当前突发期的结束时刻
+};
+
+// 服务时间分布(微秒)，均值都是serviceUs
+class ServiceDistribution {
+public:
+	explicit ServiceDistribution(const Options& opt) : opt_(opt) {}
+
+	double sample(mt19937_64& rng)
+	{
+		double mean = opt_.serviceUs;
+		if (opt_.service == "fixed") {
+			return mean;
+		}
+		if (opt_.service == "exponential") {
+			return exponential_distribution<double>(1 / mean)(rng);
+		}
+		if (opt_.service == "lognormal") {
+			double sigma = opt_.serviceSigma;
+			return lognormal_distribution<double>(log(mean) - sigma * sigma / 2, sigma)(rng);
+		}
+		// bimodal 95%的短任务和5%的长任务，长任务是短任务的10倍
+		double shortUs = mean / (0.95 + 0.05 * 10);
+		return uniform_int_distribution<int>(0, 99)(rng) < 95 ? shortUs : shortUs * 10;
+	}
+
+private:
+	const Options& opt_;
+};
+
+// 在工作线程上消耗服务时间
+void doWork(double serviceUs, bool spin)
+{
+	auto end = Clock::now() + chrono::duration_cast<Clock::duration>(chrono::duration<double, micro>(serviceUs));
+	if (!spin) {
+		this_thread::sleep_until(end);
+		return;
+	}
+	while (Clock::now() < end) {
+	}
+}
+
+double offeredRate(const Options& opt)
+{
+	return opt.rate > 0 ? opt.rate : opt.utilization * opt.threads * 1e6 / opt.serviceUs;
+}
+
+
+/////////////// 运行一种线程池配置
+
+template<typename Pool>
+RunResult runLoad(const Options& opt, const string& name, PoolMode mode)
+{
+	RunResult result;
+	result.mode = name;
+	result.offeredRps = offeredRate(opt);
+
+	LatencyHistogram corrected; //从计划时刻算起
+	LatencyHistogram raw; //从实际提交时刻算起
+	atomic<uint64_t> completed(0);
+	bool spin = opt.work != "sleep";
+
+	Clock::time_point start;
+	{
+		Pool pool;
+		pool.setMode(mode);
+		if (mode == MODE_CACHED) {
+			pool.setTaskQueSizeThreshHold(opt.maxThreads);
+		}
+		pool.start(opt.threads);
+
+		mt19937_64 rng(opt.seed);
+		ArrivalProcess arrivals(opt, result.offeredRps);
+		ServiceDistribution service(opt);
+
+		start = Clock::now();
+		for (;;) {
+			double t = arrivals.next(rng);
+			if (t >= opt.duration) {
+				break;
+			}
+			double serviceUs = service.sample(rng);
+			auto intended = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(t));
+
+			// 开环：只按计划时刻发出，不管之前的请求有没有完成
+			this_thread::sleep_until(intended);
+			auto submitted = Clock::now();
+			result.maxSendLagUs = max(result.maxSendLagUs, chrono::duration<double, micro>(submitted - intended).count());
+
+			bool record = t >= opt.warmup;
+			// 队列满时不能等待(submitTask会阻塞发送线程1秒，打乱之后的发送计划)，立刻记为拒绝继续按计划发送
+			auto res = pool.trySubmitTask([&corrected, &raw, &completed, intended, submitted, serviceUs, spin, record]() {
+				doWork(serviceUs, spin);
+				auto done = Clock::now();
+				if (record) {
+					corrected.record((uint64_t)chrono::duration_cast<chrono::nanoseconds>(done - intended).count());
+					raw.record((uint64_t)chrono::duration_cast<chrono::nanoseconds>(done - submitted).count());
+				}
+				completed.fetch_add(1, memory_order_relaxed);
+				return true;
+				});
+			result.sent++;
+			if (!res.valid()) {
+				result.rejected++;
+			}
+			result.peakThreads = max(result.peakThreads, pool.getThreadSize());
+		}
+	} // 线程池析构时执行完剩余的任务
+	double elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+	result.completed = completed;
+	result.achievedRps = result.completed / elapsed;
+	result.recorded = corrected.count();
+	result.meanUs = corrected.mean() / 1000.0;
+	for (double p : PERCENTILES) {
+		result.percentilesUs.push_back(corrected.percentile(p) / 1000.0);
+	}
+	result.maxUs = corrected.max() / 1000.0;
+	result.rawP99Us = raw.percentile(99) / 1000.0;
+	return result;
+}
+
+// 参与对比的线程池配置，新的调度模式在这里加一项即可
+struct PoolVariant {
+	const char* name;
+	const char* description;
+	function<RunResult(const Options&)> run;
+};
+
+const vector<PoolVariant>& poolVariants()
+{
+	static const vector<PoolVariant> variants = {
+		{ "fixed", "ThreadPool MODE_FIXED",
+			[](const Options& opt) { return runLoad<ThreadPool>(opt, "fixed", MODE_FIXED); } },
+		{ "cached", "ThreadPool MODE_CACHED, up to --max-threads",
+			[](const Options& opt) { return runLoad<ThreadPool>(opt, "cached", MODE_CACHED); } },
+		{ "fixed_notify_one", "MODE_FIXED with NotifyOneWakeup",
+			[](const Options& opt) { return runLoad<BasicThreadPool<DequeQueuePolicy, NotifyOneWakeup>>(opt, "fixed_notify_one", MODE_FIXED); } },
+		{ "fixed_ring", "MODE_FIXED with RingQueuePolicy<65536>, NotifyOneWakeup and inline task storage",
+			[](const Options& opt) { return runLoad<BasicThreadPool<RingQueuePolicy<65536>, NotifyOneWakeup, NoStats, 128>>(opt, "fixed_ring", MODE_FIXED); } },
+	};
+	return variants;
+}
+
+
+/////////////// 命令行和输出
+
+void usage()
+{
+	Options def;
+	cout << "usage: load_generator [--option=value ...]\n"
+		<< "  --mode=LIST             comma separated pool variants (default fixed,cached)\n"
+		<< "  --threads=N             initial worker threads (default " << def.threads << ")\n"
+		<< "  --max-threads=N         thread limit in MODE_CACHED (default " << def.maxThreads << ")\n"
+		<< "  --arrival=KIND          uniform|poisson|bursty|diurnal (default " << def.arrival << ")\n"
+		<< "  --rate=RPS              mean requests per second, overrides --utilization\n"
+		<< "  --utilization=U         target load, rate = U * threads / service-us (default " << def.utilization << ")\n"
+		<< "  --service=KIND          fixed|exponential|lognormal|bimodal (default " << def.service << ")\n"
+		<< "  --service-us=US         mean service time in microseconds (default " << def.serviceUs << ")\n"
+		<< "  --service-sigma=S       sigma of the lognormal service time (default " << def.serviceSigma << ")\n"
+		<< "  --work=KIND             spin (burn CPU) or sleep (default " << def.work << ")\n"
+		<< "  --burst-ms=MS           bursty: mean burst length (default " << def.burstMs << ")\n"
+		<< "  --burst-duty=D          bursty: fraction of time in bursts (default " << def.burstDuty << ")\n"
+		<< "  --diurnal-period=S      diurnal: period of the rate sine wave in seconds (default " << def.diurnalPeriod << ")\n"
+		<< "  --diurnal-amplitude=A   diurnal: rate varies within rate*(1+-A) (default " << def.diurnalAmplitude << ")\n"
+		<< "  --duration=S            seconds per variant (default " << def.duration << ")\n"
+		<< "  --warmup=S              leading seconds excluded from statistics (default " << def.warmup << ")\n"
+		<< "  --format=KIND           text|csv|json (default " << def.format << ")\n"
+		<< "  --output=FILE           write results to FILE instead of stdout\n"
+		<< "  --seed=N                random seed (default " << def.seed << ")\n"
+		<< "pool variants:\n";
+	for (auto& v : poolVariants()) {
+		cout << "  " << left << setw(22) << v.name << v.description << "\n";
+	}
+}
+
+// 解析失败时打印原因并退出
+bool parseOptions(int argc, char* argv[], Options& opt)
+{
+	map<string, function<void(const string&)>> setters = {
+		{ "mode", [&](const string& v) {
+			opt.modes.clear();
+			stringstream ss(v);
+			string item;
+			while (getline(ss, item, ',')) {
+				opt.modes.push_back(item);
+			}
+		} },
+		{ "threads", [&](const string& v) { opt.threads = stoi(v); } },
+		{ "max-threads", [&](const string& v) { opt.maxThreads = stoi(v); } },
+		{ "arrival", [&](const string& v) { opt.arrival = v; } },
+		{ "rate", [&](const string& v) { opt.rate = stod(v); } },
+		{ "utilization", [&](const string& v) { opt.utilization = stod(v); } },
+		{ "service", [&](const string& v) { opt.service = v; } },
+		{ "service-us", [&](const string& v) { opt.serviceUs = stod(v); } },
+		{ "service-sigma", [&](const string& v) { opt.serviceSigma = stod(v); } },
+		{ "work", [&](const string& v) { opt.work = v; } },
+		{ "burst-ms", [&](const string& v) { opt.burstMs = stod(v); } },
+		{ "burst-duty", [&](const string& v) { opt.burstDuty = stod(v); } },
+		{ "diurnal-period", [&](const string& v) { opt.diurnalPeriod = stod(v); } },
+		{ "diurnal-amplitude", [&](const string& v) { opt.diurnalAmplitude = stod(v); } },
+		{ "duration", [&](const string& v) { opt.duration = stod(v); } },
+		{ "warmup", [&](const string& v) { opt.warmup = stod(v); } },
+		{ "format", [&](const string& v) { opt.format = v; } },
+		{ "output", [&](const string& v) { opt.output = v; } },
+		{ "seed", [&](const string& v) { opt.seed = stoull(v); } },
+	};
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			usage();
+			exit(0);
+		}
+		size_t eq = arg.find('=');
+		if (arg.compare(0, 2, "--") != 0 || eq == string::npos || setters.count(arg.substr(2, eq - 2)) == 0) {
+			cerr << "unknown option: " << arg << endl;
+			return false;
+		}
+		try {
+			setters[arg.substr(2, eq - 2)](arg.substr(eq + 1));
+		}
+		catch (const exception&) {
+			cerr << "invalid value: " << arg << endl;
+			return false;
+		}
+	}
+
+	auto oneOf = [](const string& v, initializer_list<const char*> choices) {
+		return any_of(choices.begin(), choices.end(), [&](const char* c) { return v == c; });
+	};
+	if (!oneOf(opt.arrival, { "uniform", "poisson", "bursty", "diurnal" })
+		|| !oneOf(opt.service, { "fixed", "exponential", "lognormal", "bimodal" })
+		|| !oneOf(opt.work, { "spin", "sleep" })
+		|| !oneOf(opt.format, { "text", "csv", "json" })) {
+		cerr << "invalid --arrival, --service, --work or --format" << endl;
+		return false;
+	}
+	if (opt.threads <= 0 || opt.serviceUs <= 0 || offeredRate(opt) <= 0 || opt.duration <= opt.warmup
+		|| opt.burstDuty <= 0 || opt.burstDuty > 1 || opt.diurnalAmplitude < 0 || opt.diurnalAmplitude > 1) {
+		cerr << "invalid numeric option" << endl;
+		return false;
+	}
+	for (auto& mode : opt.modes) {
+		auto& variants = poolVariants();
+		if (none_of(variants.begin(), variants.end(), [&](const PoolVariant& v) { return mode == v.name; })) {
+			cerr << "unknown pool variant: " << mode << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+string percentileName(double p)
+{
+	ostringstream ss;
+	ss << "p" << p;
+	string name = ss.str();
+	name.erase(remove(name.begin(), name.end(), '.'), name.end());
+	return name;
+}
+
+void writeText(ostream& out, const Options& opt, const vector<RunResult>& results)
+{
+	out << "arrival = " << opt.arrival << ", service = " << opt.service << " " << opt.serviceUs << "us"
+		<< ", threads = " << opt.threads << ", offered = " << fixed << setprecision(0) << offeredRate(opt) << " req/s"
+		<< ", duration = " << opt.duration << "s" << endl;
+	out << "latency in microseconds, measured from the intended send time" << endl;
+
+	out << left << setw(18) << "mode" << right << setw(10) << "req/s" << setw(9) << "rejected";
+	for (double p : PERCENTILES) {
+		out << setw(10) << percentileName(p);
+	}
+	out << setw(10) << "max" << setw(10) << "raw_p99" << setw(9) << "threads" << endl;
+
+	for (auto& r : results) {
+		out << left << setw(18) << r.mode << right << fixed << setprecision(0) << setw(10) << r.achievedRps << setw(9) << r.rejected
+			<< setprecision(1);
+		for (double v : r.percentilesUs) {
+			out << setw(10) << v;
+		}
+		out << setw(10) << r.maxUs << setw(10) << r.rawP99Us << setw(9) << r.peakThreads << endl;
+	}
+}
+
+void writeCsv(ostream& out, const Options& opt, const vector<RunResult>& results)
+{
+	out << fixed << setprecision(1);
+	out << "mode,arrival,service,service_us,threads,offered_rps,achieved_rps,sent,completed,rejected,recorded,mean_us";
+	for (double p : PERCENTILES) {
+		out << "," << percentileName(p) << "_us";
+	}
+	out << ",max_us,raw_p99_us,max_send_lag_us,peak_threads" << endl;
+
+	for (auto& r : results) {
+		out << r.mode << "," << opt.arrival << "," << opt.service << "," << opt.serviceUs << "," << opt.threads << ","
+			<< r.offeredRps << "," << r.achievedRps << ","
+			<< r.sent << "," << r.completed << "," << r.rejected << "," << r.recorded << "," << r.meanUs;
+		for (double v : r.percentilesUs) {
+			out << "," << v;
+		}
+		out << "," << r.maxUs << "," << r.rawP99Us << "," << r.maxSendLagUs << "," << r.peakThreads << endl;
+	}
+}
+
+void writeJson(ostream& out, const Options& opt, const vector<RunResult>& results)
+{
+	out << fixed << setprecision(1) << "{\n"
+		<< "  \"arrival\": \"" << opt.arrival << "\",\n"
+		<< "  \"service\": \"" << opt.service << "\",\n"
+		<< "  \"service_us\": " << opt.serviceUs << ",\n"
+		<< "  \"threads\": " << opt.threads << ",\n"
+		<< "  \"duration_s\": " << opt.duration << ",\n"
+		<< "  \"warmup_s\": " << opt.warmup << ",\n"
+		<< "  \"seed\": " << opt.seed << ",\n"
+		<< "  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		auto& r = results[i];
+		out << "    {\"mode\": \"" << r.mode << "\", \"offered_rps\": " << r.offeredRps << ", \"achieved_rps\": " << r.achievedRps
+			<< ", \"sent\": " << r.sent << ", \"completed\": " << r.completed << ", \"rejected\": " << r.rejected
+			<< ", \"recorded\": " << r.recorded << ", \"mean_us\": " << r.meanUs;
+		for (size_t k = 0; k < r.percentilesUs.size(); k++) {
+			out << ", \"" << percentileName(PERCENTILES[k]) << "_us\": " << r.percentilesUs[k];
+		}
+		out << ", \"max_us\": " << r.maxUs << ", \"raw_p99_us\": " << r.rawP99Us
+			<< ", \"max_send_lag_us\": " << r.maxSendLagUs << ", \"peak_threads\": " << r.peakThreads << "}"
+			<< (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "  ]\n}" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	Options opt;
+	if (!parseOptions(argc, argv, opt)) {
+		usage();
+		return 1;
+	}
+
+	vector<RunResult> results;
+	for (auto& mode : opt.modes) {
+		for (auto& v : poolVariants()) {
+			if (mode == v.name) {
+				cerr << "running " << v.name << " for " << opt.duration << "s ..." << endl;
+				results.push_back(v.run(opt));
+			}
+		}
+	}
+
+	ofstream file;
+	if (!opt.output.empty()) {
+		file.open(opt.output);
+		if (!file) {
+			cerr << "cannot open " << opt.output << endl;
+			return 1;
+		}
+	}
+	ostream& out = opt.output.empty() ? cout : file;
+
+	if (opt.format == "csv") {
+		writeCsv(out, opt, results);
+	}
+	else if (opt.format == "json") {
+		writeJson(out, opt, results);
+	}
+	else {
+		writeText(out, opt, results);
+	}
+	return 0;
+}
@@ -0,0 +1,148 @@
+﻿#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <random>
+#include <cstdint>
+
+// 确定性调度
+// 被测线程串行执行，同一时刻只有一个线程在运行，线程只在调度点(THREAD_POOL_SCHED_POINT)切换
+// 每个调度点按种子随机决定是否切换、切换到哪个线程，同一个种子得到同一种交错执行，失败可以按种子复现
+// 换不同的种子反复运行，就是对交错执行空间的随机探索
+// 线程之间通过调度器的锁交接执行权，因此只能探索顺序一致的交错，不模拟弱内存序下的重排
+// 必须在包含被测头文件之前包含本头文件
+
+class DeterministicScheduler;
+
+namespace sched_detail {
+	inline thread_local DeterministicScheduler* current = nullptr; // 当前线程所属的调度器
+	inline thread_local int self = -1; // 当前线程在调度器中的编号
+}
+
+#define THREAD_POOL_SCHED_POINT() DeterministicScheduler::schedPoint()
+
+class DeterministicScheduler {
+public:
+	// switchPercent: 每个调度点切换到其他线程的概率(百分比)
+	// maxSteps: 调度点总数上限，超过后认为出现了活锁
+	explicit DeterministicScheduler(uint64_t seed, int switchPercent = 30, uint64_t maxSteps = 1000000)
+		: rng_(seed)
+		, switchPercent_(switchPercent)
+		, maxSteps_(maxSteps)
+		, steps_(0)
+		, current_(-1)
+		, livelock_(false)
+	{}
+
+	DeterministicScheduler(const DeterministicScheduler&) = delete;
+	DeterministicScheduler& operator=(const DeterministicScheduler&) = delete;
+
+	//运行一组线程函数直到全部结束，返回false表示出现了活锁
+	bool run(const std::vector<std::function<void()>>& funcs)
+	{
+		done_.assign(funcs.size(), false);
+
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < funcs.size(); i++) {
+			threads.emplace_back([this, i, &funcs]() {
+				sched_detail::current = this;
+				sched_detail::self = (int)i;
+				waitTurn((int)i);
+				funcs[i]();
+				finish((int)i);
+				sched_detail::current = nullptr;
+				});
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(mtx_);
+			current_ = pickLocked(-1);
+			cond_.notify_all();
+		}
+
+		for (auto& t : threads) {
+			t.join();
+		}
+		return !livelock_;
+	}
+
+	//调度点 不在调度器中运行的线程直接返回
+	static void schedPoint()
+	{
+		if (sched_detail::current != nullptr) {
+			sched_detail::current->yield(sched_detail::self);
+		}
+	}
+
+	//已经执行的调度点数量
+	uint64_t getSteps() const { return steps_; }
+
+private:
+	void waitTurn(int self)
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+		cond_.wait(lock, [&]()->bool { return current_ == self || livelock_; });
+	}
+
+	void yield(int self)
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+		if (livelock_) {
+			return;
+		}
+		if (++steps_ > maxSteps_) {
+			// 活锁 放开所有线程并发执行，让它们各自跑完
+			livelock_ = true;
+			cond_.notify_all();
+			return;
+		}
+		if ((int)(rng_() % 100) >= switchPercent_) {
+			return;
+		}
+
+		int next = pickLocked(self);
+		if (next != self) {
+			current_ = next;
+			cond_.notify_all();
+			cond_.wait(lock, [&]()->bool { return current_ == self || livelock_; });
+		}
+	}
+
+	void finish(int self)
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+		done_[self] = true;
+		current_ = pickLocked(-1);
+		cond_.notify_all();
+	}
+
+	//随机选择一个没有结束的线程 全部结束返回-1
+	int pickLocked(int self)
+	{
+		std::vector<int> runnable;
+		for (size_t i = 0; i < done_.size(); i++) {
+			if (!done_[i] && (int)i != self) {
+				runnable.push_back((int)i);
+			}
+		}
+		if (runnable.empty()) {
+			return self;
+		}
+		return runnable[rng_() % runnable.size()];
+	}
+
+private:
+	std::mt19937_64 rng_;
+	int switchPercent_;
+	uint64_t maxSteps_;
+	uint64_t steps_;
+
+	std::mutex mtx_;
+	std::condition_variable cond_;
+	std::vector<bool> done_; //线程是否已经结束
+	int current_; //持有执行权的线程
+	bool livelock_; //出现活锁后不再串行调度
+};
@@ -0,0 +1,142 @@
+﻿#pragma once
+
+#include <vector>
+#include <deque>
+#include <set>
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <cstdint>
+
+// 队列的线性一致性检查(Wing & Gong 回溯搜索，按Lowe的方法对已访问状态做记忆化)
+// 并发执行时记录每个操作的调用/返回时刻，然后寻找一个与实时顺序相容、并且符合FIFO队列语义的串行顺序
+// 历史记录不超过64个操作，测试里用多轮小历史代替一轮大历史
+
+enum QueueOpType {
+	QUEUE_PUSH,
+	QUEUE_POP,
+};
+
+// 一次已完成的队列操作
+struct QueueOp {
+	QueueOpType type;
+	int value; //push的值，或者pop成功时取到的值
+	bool ok; //push/pop是否成功
+	uint64_t invoke; //调用时刻
+	uint64_t response; //返回时刻
+};
+
+// 并发记录操作的时钟 用全局递增计数代替真实时间，调用前和返回后各取一次
+class HistoryClock {
+public:
+	HistoryClock() : now_(0) {}
+	uint64_t tick() { return now_.fetch_add(1); }
+
+private:
+	std::atomic<uint64_t> now_;
+};
+
+// allowSpuriousFailure为true时，与push重叠的pop可以返回空，与pop重叠的push可以返回满
+// 这是BoundedQueue文档中允许的行为：其他线程的操作进行到一半时，格子还不能读写
+class QueueLinearizabilityChecker {
+public:
+	QueueLinearizabilityChecker(const std::vector<QueueOp>& history, size_t capacity, bool allowSpuriousFailure)
+		: history_(history)
+		, capacity_(capacity)
+		, allowSpuriousFailure_(allowSpuriousFailure)
+	{}
+
+	bool check()
+	{
+		if (history_.size() > 64) {
+			return false;
+		}
+		visited_.clear();
+		std::deque<int> state;
+		return search(0, state);
+	}
+
+private:
+	bool search(uint64_t linearized, std::deque<int>& state)
+	{
+		size_t n = history_.size();
+		if (linearized == fullMask(n)) {
+			return true;
+		}
+		if (!visited_.emplace(linearized, std::vector<int>(state.begin(), state.end())).second) {
+			return false;
+		}
+
+		// 还没有线性化的操作里最早的返回时刻，只有在它之前调用的操作才能排在下一个
+		uint64_t minResponse = UINT64_MAX;
+		for (size_t i = 0; i < n; i++) {
+			if (!(linearized >> i & 1)) {
+				minResponse = std::min(minResponse, history_[i].response);
+			}
+		}
+
+		for (size_t i = 0; i < n; i++) {
+			if ((linearized >> i & 1) || history_[i].invoke > minResponse) {
+				continue;
+			}
+
+			const QueueOp& op = history_[i];
+			uint64_t next = linearized | (uint64_t(1) << i);
+			if (op.type == QUEUE_PUSH) {
+				if (op.ok && state.size() < capacity_) {
+					state.push_back(op.value);
+					if (search(next, state)) {
+						return true;
+					}
+					state.pop_back();
+				}
+				else if (!op.ok && (state.size() >= capacity_ || spuriousAllowed(i, QUEUE_POP))) {
+					if (search(next, state)) {
+						return true;
+					}
+				}
+			}
+			else {
+				if (op.ok && !state.empty() && state.front() == op.value) {
+					state.pop_front();
+					if (search(next, state)) {
+						return true;
+					}
+					state.push_front(op.value);
+				}
+				else if (!op.ok && (state.empty() || spuriousAllowed(i, QUEUE_PUSH))) {
+					if (search(next, state)) {
+						return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+	//操作i是否与某个other类型的操作在时间上重叠
+	bool spuriousAllowed(size_t i, QueueOpType other) const
+	{
+		if (!allowSpuriousFailure_) {
+			return false;
+		}
+		for (size_t j = 0; j < history_.size(); j++) {
+			if (j != i && history_[j].type == other
+				&& history_[j].invoke < history_[i].response && history_[i].invoke < history_[j].response) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static uint64_t fullMask(size_t n)
+	{
+		return n == 64 ? UINT64_MAX : (uint64_t(1) << n) - 1;
+	}
+
+private:
+	const std::vector<QueueOp>& history_;
+	size_t capacity_;
+	bool allowSpuriousFailure_;
+	std::set<std::pair<uint64_t, std::vector<int>>> visited_; //已经搜索过并且失败的状态
+};
@@ -0,0 +1,295 @@
+﻿// Executor/ExecutorArena和Strand/KeyedDispatcher测试：并发上限、加权公平、串行顺序、线程池拒绝任务
+#include "test_harness.h"
+
+#include "executor.h"
+#include "strand.h"
+
+namespace {
+
+	class Gate {
+	public:
+		Gate() : future_(promise_.get_future().share()) {}
+		void open() { promise_.set_value(); }
+		void wait() const { future_.wait(); }
+
+	private:
+		std::promise<void> promise_;
+		std::shared_future<void> future_;
+	};
+
+	// 记录同时执行的任务数和出现过的最大值
+	class ConcurrencyProbe {
+	public:
+		ConcurrencyProbe() : current_(0), max_(0) {}
+
+		void enter()
+		{
+			int cur = ++current_;
+			int old = max_;
+			while (cur > old && !max_.compare_exchange_weak(old, cur)) {
+			}
+		}
+		void leave() { current_--; }
+		int getMax() const { return max_; }
+
+	private:
+		std::atomic_int current_;
+		std::atomic_int max_;
+	};
+}
+
+TEST_CASE(executor_max_concurrency)
+{
+	ThreadPool pool;
+	pool.start(4);
+	ExecutorArena arena(pool, 4);
+	Executor& limited = arena.createExecutor(1, 2);
+	Executor& other = arena.createExecutor();
+
+	ConcurrencyProbe probe;
+	std::vector<std::future<int>> results;
+	for (int i = 0; i < 100; i++) {
+		results.emplace_back(limited.submitTask([&probe](int x) {
+			probe.enter();
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+			probe.leave();
+			return x;
+			}, i));
+		other.submitTask([]() {});
+	}
+	for (int i = 0; i < (int)results.size(); i++) {
+		CHECK(results[i].get() == i);
+	}
+	CHECK(probe.getMax() >= 1);
+	CHECK(probe.getMax() <= 2);
+
+	// 运行中调低并发上限
+	ConcurrencyProbe serial;
+	limited.setMaxConcurrency(1);
+	std::vector<std::future<void>> more;
+	for (int i = 0; i < 50; i++) {
+		more.emplace_back(limited.submitTask([&serial]() {
+			serial.enter();
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+			serial.leave();
+			}));
+	}
+	for (auto& res : more) {
+		res.get();
+	}
+	CHECK(serial.getMax() == 1);
+	CHECK(limited.pendingTaskSize() == 0);
+}
+
+TEST_CASE(executor_arena_parallelism_cap)
+{
+	// 线程池的线程比令牌上限多，正在执行任务的令牌也要算进上限
+	ThreadPool pool;
+	pool.start(8);
+
+	for (int parallelism = 1; parallelism <= 2; parallelism++) {
+		ExecutorArena arena(pool, parallelism);
+		Executor& a = arena.createExecutor();
+		Executor& b = arena.createExecutor(2);
+
+		ConcurrencyProbe probe;
+		std::vector<std::future<void>> results;
+		for (int i = 0; i < 100; i++) {
+			for (Executor* ex : { &a, &b }) {
+				results.emplace_back(ex->submitTask([&probe]() {
+					probe.enter();
+					std::this_thread::sleep_for(std::chrono::microseconds(200));
+					probe.leave();
+					}));
+			}
+		}
+		for (auto& res : results) {
+			res.get();
+		}
+		CHECK(probe.getMax() >= 1);
+		CHECK(probe.getMax() <= parallelism);
+	}
+}
+
+TEST_CASE(executor_weighted_fairness)
+{
+	// 一个工作线程，先用阻塞任务占住，让两个执行器的任务全部排好队再开始执行
+	ThreadPool pool;
+	pool.start(1);
+	ExecutorArena arena(pool, 1);
+	Executor& light = arena.createExecutor(1);
+	Executor& heavy = arena.createExecutor(3);
+
+	Gate gate;
+	pool.submitTask([&gate]() { gate.wait(); });
+
+	std::mutex mtx;
+	std::vector<int> order;
+	std::vector<std::future<void>> results;
+	for (int i = 0; i < 400; i++) {
+		results.emplace_back(light.submitTask([&]() { std::lock_guard<std::mutex> lock(mtx); order.push_back(0); }));
+		results.emplace_back(heavy.submitTask([&]() { std::lock_guard<std::mutex> lock(mtx); order.push_back(1); }));
+	}
+	gate.open();
+	for (auto& res : results) {
+		res.get();
+	}
+
+	// 两个执行器都有积压时，heavy应当分到约3/4的执行机会
+	REQUIRE(order.size() == 800);
+	int heavyCount = 0;
+	for (int i = 0; i < 400; i++) {
+		heavyCount += order[i];
+	}
+	CHECK(heavyCount >= 270 && heavyCount <= 330);
+}
+
+TEST_CASE(strand_order_stress)
+{
+	std::mt19937_64 rng(testSeed());
+	const int strandSize = 8;
+	const int producers = 4;
+	const int perProducer = 2000 * testIterations();
+
+	ThreadPool pool;
+	pool.start(4);
+
+	struct Log {
+		std::vector<std::pair<int, int>> entries; //(生产者, 序号) 只在strand内访问，不加锁
+		std::atomic_int inside{ 0 };
+	};
+	std::vector<std::unique_ptr<Strand<>>> strands;
+	std::vector<Log> logs(strandSize);
+	for (int i = 0; i < strandSize; i++) {
+		strands.emplace_back(std::make_unique<Strand<>>(pool));
+	}
+
+	std::atomic_bool overlapped(false);
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++) {
+		uint64_t seed = rng();
+		threads.emplace_back([&, p, seed]() {
+			std::mt19937_64 local(seed);
+			for (int i = 0; i < perProducer; i++) {
+				int s = (int)(local() % strandSize);
+				strands[s]->submitTask([&, s, p, i]() {
+					if (logs[s].inside++ != 0) {
+						overlapped = true;
+					}
+					logs[s].entries.emplace_back(p, i);
+					logs[s].inside--;
+					});
+			}
+			});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+	strands.clear(); // Strand析构时等待剩余任务执行完
+
+	CHECK(!overlapped);
+	size_t total = 0;
+	for (auto& log : logs) {
+		total += log.entries.size();
+		std::vector<int> last(producers, -1);
+		for (auto& e : log.entries) {
+			CHECK(e.second > last[e.first]);
+			last[e.first] = e.second;
+		}
+	}
+	CHECK(total == (size_t)producers * perProducer);
+}
+
+TEST_CASE(strand_on_executor)
+{
+	ThreadPool pool;
+	pool.start(3);
+	ExecutorArena arena(pool, 3);
+	Executor& ex = arena.createExecutor();
+
+	std::vector<int> seen;
+	{
+		Strand<Executor> strand(ex);
+		for (int i = 0; i < 1000; i++) {
+			strand.submitTask([&seen, i]() { seen.push_back(i); });
+		}
+		CHECK(strand.submitTask([]() { return 7; }).get() == 7);
+	}
+
+	REQUIRE(seen.size() == 1000);
+	for (int i = 0; i < 1000; i++) {
+		CHECK(seen[i] == i);
+	}
+}
+
+TEST_CASE(keyed_dispatcher_per_key_order)
+{
+	const int keys = 100;
+	ThreadPool pool;
+	pool.start(4);
+
+	std::vector<int> counters(keys, 0); // 每个key只在自己的strand上修改
+	std::atomic_bool ordered(true);
+	{
+		KeyedDispatcher<int> dispatcher(pool, 16);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 2; t++) {
+			threads.emplace_back([&, t]() {
+				// 两个生产者各自负责一半的key
+				for (int round = 0; round < 50; round++) {
+					for (int k = t; k < keys; k += 2) {
+						dispatcher.submitTask(k, [&, k, round]() {
+							if (counters[k] != round) {
+								ordered = false;
+							}
+							counters[k]++;
+							});
+					}
+				}
+				});
+		}
+		for (auto& th : threads) {
+			th.join();
+		}
+		CHECK(&dispatcher.strandFor(3) == &dispatcher.strandFor(3));
+	}
+
+	CHECK(ordered);
+	for (int k = 0; k < keys; k++) {
+		CHECK(counters[k] == 50);
+	}
+}
+
+TEST_CASE(executor_strand_pool_rejects)
+{
+	// 线程池队列一个任务也放不下：令牌和drain任务都在提交者线程上执行，任务不会丢，析构也不会卡住
+	ThreadPool pool;
+	pool.setTaskQueMaxThreshHold(0);
+	pool.start(2);
+
+	{
+		ExecutorArena arena(pool, 2);
+		Executor& ex = arena.createExecutor(1, 1);
+		std::vector<std::future<int>> results;
+		for (int i = 0; i < 100; i++) {
+			results.emplace_back(ex.submitTask([](int x) { return x * 2; }, i));
+		}
+		for (int i = 0; i < (int)results.size(); i++) {
+			CHECK(results[i].get() == i * 2);
+		}
+	}
+
+	std::vector<int> seen;
+	{
+		Strand<> strand(pool);
+		for (int i = 0; i < 3 * STRAND_BATCH_SIZE; i++) {
+			strand.submitTask([&seen, i]() { seen.push_back(i); });
+		}
+		CHECK(strand.submitTask([]() { return 7; }).get() == 7);
+		CHECK(strand.pendingTaskSize() == 0);
+	}
+	REQUIRE(seen.size() == (size_t)3 * STRAND_BATCH_SIZE);
+	for (int i = 0; i < (int)seen.size(); i++) {
+		CHECK(seen[i] == i);
+	}
+}
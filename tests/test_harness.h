@@ -0,0 +1,137 @@
+﻿#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <random>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+// 最小测试框架
+// 每个测试文件编译成一个可执行文件，包含本头文件后用TEST_CASE定义测试用例，main函数由本头文件提供
+// 用法: test_xxx [--list] [用例名...]  不带用例名时运行全部用例
+// 环境变量:
+//   THREAD_POOL_TEST_SEED        随机种子，默认每次运行随机生成，失败时会打印出来用于复现
+//   THREAD_POOL_TEST_ITERATIONS  压力测试的迭代倍数，默认1，长时间跑压力时调大
+
+struct TestCase {
+	const char* name;
+	void (*func)();
+};
+
+// 某个CHECK失败时抛出，结束当前用例
+struct TestFailure {};
+
+inline std::vector<TestCase>& testRegistry()
+{
+	static std::vector<TestCase> cases;
+	return cases;
+}
+
+struct TestRegistrar {
+	TestRegistrar(const char* name, void (*func)()) { testRegistry().push_back(TestCase{ name, func }); }
+};
+
+inline std::atomic_int& testFailureCount()
+{
+	static std::atomic_int count(0);
+	return count;
+}
+
+inline uint64_t testSeed()
+{
+	static uint64_t seed = []() -> uint64_t {
+		const char* env = std::getenv("THREAD_POOL_TEST_SEED");
+		if (env != nullptr) {
+			return std::strtoull(env, nullptr, 10);
+		}
+		return ((uint64_t)std::random_device()() << 32) ^ std::random_device()();
+	}();
+	return seed;
+}
+
+inline int testIterations()
+{
+	static int iterations = []() -> int {
+		const char* env = std::getenv("THREAD_POOL_TEST_ITERATIONS");
+		int n = env != nullptr ? std::atoi(env) : 1;
+		return n > 0 ? n : 1;
+	}();
+	return iterations;
+}
+
+// 记录失败 可以在工作线程中调用
+inline void testFail(const char* expr, const char* file, int line)
+{
+	testFailureCount()++;
+	std::cerr << file << ":" << line << ": CHECK failed: " << expr << std::endl;
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static TestRegistrar name##_registrar(#name, name); \
+	static void name()
+
+// 失败后继续执行
+#define CHECK(cond) \
+	do { if (!(cond)) { testFail(#cond, __FILE__, __LINE__); } } while (0)
+
+// 失败后结束当前用例 只能在测试线程中使用
+#define REQUIRE(cond) \
+	do { if (!(cond)) { testFail(#cond, __FILE__, __LINE__); throw TestFailure(); } } while (0)
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> filter;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--list") == 0) {
+			for (auto& tc : testRegistry()) {
+				std::cout << tc.name << std::endl;
+			}
+			return 0;
+		}
+		filter.emplace_back(argv[i]);
+	}
+
+	std::cout << "seed = " << testSeed() << ", iterations = " << testIterations() << std::endl;
+
+	int failedCases = 0;
+	int runCases = 0;
+	for (auto& tc : testRegistry()) {
+		if (!filter.empty() && std::find(filter.begin(), filter.end(), tc.name) == filter.end()) {
+			continue;
+		}
+
+		runCases++;
+		int before = testFailureCount();
+		auto begin = std::chrono::steady_clock::now();
+		try {
+			tc.func();
+		}
+		catch (const TestFailure&) {
+		}
+		catch (const std::exception& e) {
+			testFailureCount()++;
+			std::cerr << "unexpected exception: " << e.what() << std::endl;
+		}
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+
+		bool ok = testFailureCount() == before;
+		if (!ok) {
+			failedCases++;
+		}
+		std::cout << (ok ? "[  OK  ] " : "[FAILED] ") << tc.name << " (" << ms << " ms)" << std::endl;
+	}
+
+	if (failedCases != 0) {
+		std::cout << failedCases << " of " << runCases << " test cases failed, rerun with THREAD_POOL_TEST_SEED=" << testSeed() << std::endl;
+		return 1;
+	}
+	std::cout << runCases << " test cases passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,135 @@
+﻿// IoReactor协程接口测试(C++20，仅Linux)：co_await读、写、accept，每个用例分别在两个后端上运行
+#include "test_harness.h"
+
+#include "io_reactor.h"
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string>
+
+#ifndef THREAD_POOL_HAS_COROUTINE
+#error "test_io_coroutine needs C++20 coroutines"
+#endif
+
+namespace {
+
+	const IoBackend TEST_BACKENDS[] = { IO_BACKEND_AUTO, IO_BACKEND_EPOLL };
+
+	// 测试结束时自动关闭的fd
+	class Fd {
+	public:
+		explicit Fd(int fd = -1) : fd_(fd) {}
+		~Fd() { if (fd_ >= 0) { close(fd_); } }
+		Fd(const Fd&) = delete;
+		Fd& operator=(const Fd&) = delete;
+		int get() const { return fd_; }
+
+	private:
+		int fd_;
+	};
+
+	// 立即开始执行、结束后自动销毁的协程 结果通过std::promise交给测试线程
+	struct Detached {
+		struct promise_type {
+			Detached get_return_object() { return Detached(); }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() { std::terminate(); }
+		};
+	};
+
+	struct PipeResult {
+		ssize_t written = 0;
+		ssize_t read = 0;
+		std::string data;
+		bool onWorker = false; //是否在线程池的工作线程上恢复
+	};
+
+	Detached pipeRoundTrip(IoReactor& reactor, ThreadPool& pool, int r, int w, std::promise<PipeResult>& out)
+	{
+		PipeResult result;
+		char buf[16] = { 0 };
+		result.written = co_await reactor.awaitWrite(w, "hello", 5);
+		result.onWorker = ThreadPool::currentPool() == &pool;
+		result.read = co_await reactor.awaitRead(r, buf, sizeof(buf));
+		result.onWorker = result.onWorker && ThreadPool::currentPool() == &pool;
+		result.data.assign(buf, result.read > 0 ? (size_t)result.read : 0);
+		out.set_value(result);
+	}
+
+	struct AcceptResult {
+		int fd = -1;
+		ssize_t written = 0;
+	};
+
+	Detached acceptAndGreet(IoReactor& reactor, int listener, std::promise<AcceptResult>& out)
+	{
+		AcceptResult result;
+		result.fd = (int)co_await reactor.awaitAccept(listener);
+		if (result.fd >= 0) {
+			result.written = co_await reactor.awaitWrite(result.fd, "hi", 2);
+		}
+		out.set_value(result);
+	}
+}
+
+TEST_CASE(coroutine_pipe_read_write)
+{
+	for (IoBackend backend : TEST_BACKENDS) {
+		ThreadPool pool;
+		pool.start(2);
+		IoReactor reactor(pool, backend);
+
+		int p[2];
+		REQUIRE(pipe(p) == 0);
+		Fd r(p[0]);
+		Fd w(p[1]);
+
+		std::promise<PipeResult> promise;
+		auto future = promise.get_future();
+		pipeRoundTrip(reactor, pool, r.get(), w.get(), promise);
+
+		PipeResult result = future.get();
+		CHECK(result.written == 5);
+		CHECK(result.read == 5);
+		CHECK(result.data == "hello");
+		CHECK(result.onWorker);
+	}
+}
+
+TEST_CASE(coroutine_accept)
+{
+	for (IoBackend backend : TEST_BACKENDS) {
+		ThreadPool pool;
+		pool.start(2);
+		IoReactor reactor(pool, backend);
+
+		Fd listener(socket(AF_INET, SOCK_STREAM, 0));
+		REQUIRE(listener.get() >= 0);
+		sockaddr_in addr{};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+		socklen_t addrLen = sizeof(addr);
+		REQUIRE(bind(listener.get(), (sockaddr*)&addr, sizeof(addr)) == 0);
+		REQUIRE(listen(listener.get(), 16) == 0);
+		REQUIRE(getsockname(listener.get(), (sockaddr*)&addr, &addrLen) == 0);
+
+		std::promise<AcceptResult> promise;
+		auto future = promise.get_future();
+		acceptAndGreet(reactor, listener.get(), promise);
+
+		Fd client(socket(AF_INET, SOCK_STREAM, 0));
+		REQUIRE(connect(client.get(), (sockaddr*)&addr, sizeof(addr)) == 0);
+
+		AcceptResult result = future.get();
+		Fd server(result.fd);
+		REQUIRE(server.get() >= 0);
+		CHECK(result.written == 2);
+
+		char buf[4] = { 0 };
+		CHECK(reactor.asyncRead(client.get(), buf, 2).get() == 2);
+		CHECK(std::string(buf, 2) == "hi");
+	}
+}
@@ -0,0 +1,356 @@
+﻿// IoReactor测试(仅Linux)：普通文件、管道(含超过容量的写入)、本地回环socket、大量并发操作、析构时取消、线程池拒绝任务、epoll建立失败
+// 每个用例分别在epoll后端和自动选择的后端(内核支持时为io_uring)上运行
+#include "test_harness.h"
+
+#include "io_reactor.h"
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+#include <cstdlib>
+#include <numeric>
+#include <string>
+
+namespace {
+
+	const IoBackend TEST_BACKENDS[] = { IO_BACKEND_AUTO, IO_BACKEND_EPOLL };
+
+	// 测试结束时自动关闭的fd
+	class Fd {
+	public:
+		explicit Fd(int fd = -1) : fd_(fd) {}
+		~Fd() { if (fd_ >= 0) { close(fd_); } }
+		Fd(const Fd&) = delete;
+		Fd& operator=(const Fd&) = delete;
+		int get() const { return fd_; }
+
+	private:
+		int fd_;
+	};
+}
+
+TEST_CASE(io_regular_file)
+{
+	for (IoBackend backend : TEST_BACKENDS) {
+		ThreadPool pool;
+		pool.start(2);
+		IoReactor reactor(pool, backend);
+
+		char path[] = "/tmp/thread_pool_io_XXXXXX";
+		Fd file(mkstemp(path));
+		REQUIRE(file.get() >= 0);
+		unlink(path);
+
+		std::string msg = "hello io reactor";
+		CHECK(reactor.asyncWrite(file.get(), msg.data(), msg.size(), 0).get() == (ssize_t)msg.size());
+
+		char buf[64] = { 0 };
+		CHECK(reactor.asyncRead(file.get(), buf, sizeof(buf), 6).get() == (ssize_t)msg.size() - 6);
+		CHECK(std::string(buf) == "io reactor");
+
+		// 读到文件末尾
+		CHECK(reactor.asyncRead(file.get(), buf, sizeof(buf), 1000).get() == 0);
+	}
+}
+
+TEST_CASE(io_pipe_read_before_write)
+{
+	for (IoBackend backend : TEST_BACKENDS) {
+		ThreadPool pool;
+		pool.start(2);
+		IoReactor reactor(pool, backend);
+
+		int p[2];
+		REQUIRE(pipe(p) == 0);
+		Fd r(p[0]);
+
+		char buf[16] = { 0 };
+		auto pending = reactor.asyncRead(r.get(), buf, sizeof(buf));
+		CHECK(pending.wait_for(std::chrono::milliseconds(20)) == std::future_status::timeout);
+
+		CHECK(reactor.asyncWrite(p[1], "ping", 4).get() == 4);
+		CHECK(pending.get() == 4);
+		CHECK(std::string(buf) == "ping");
+
+		// 同一个阻塞管道上排两个读，只写一次数据：一个读完成，另一个继续等待，不能卡住I/O线程
+		char first[8] = { 0 };
+		char second[8] = { 0 };
+		auto a = reactor.asyncRead(r.get(), first, 4);
+		auto b = reactor.asyncRead(r.get(), second, 4);
+		CHECK(reactor.asyncWrite(p[1], "abcd", 4).get() == 4);
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (a.wait_for(std::chrono::seconds(0)) != std::future_status::ready
+			&& b.wait_for(std::chrono::seconds(0)) != std::future_status::ready
+			&& std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		bool aDone = a.wait_for(std::chrono::milliseconds(50)) == std::future_status::ready;
+		bool bDone = b.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		REQUIRE(aDone != bDone);
+
+		// 其他fd上的操作不受影响
+		int q[2];
+		REQUIRE(pipe(q) == 0);
+		Fd qr(q[0]);
+		Fd qw(q[1]);
+		char other[8] = { 0 };
+		auto otherRead = reactor.asyncRead(qr.get(), other, 4);
+		CHECK(reactor.asyncWrite(qw.get(), "qqqq", 4).get() == 4);
+		CHECK(otherRead.wait_for(std::chrono::seconds(5)) == std::future_status::ready && otherRead.get() == 4);
+
+		CHECK(reactor.asyncWrite(p[1], "efgh", 4).get() == 4);
+		CHECK(a.get() == 4);
+		CHECK(b.get() == 4);
+		CHECK(std::string(aDone ? first : second) == "abcd");
+		CHECK(std::string(aDone ? second : first) == "efgh");
+
+		// 写端关闭后读到EOF
+		close(p[1]);
+		CHECK(reactor.asyncRead(r.get(), buf, sizeof(buf)).get() == 0);
+	}
+}
+
+TEST_CASE(io_pipe_write_exceeds_capacity)
+{
+	// 一次写入超过管道容量：写操作要等读端取走数据才能完成，这期间读操作必须能提交并完成
+	for (IoBackend backend : TEST_BACKENDS) {
+		ThreadPool pool;
+		pool.start(2);
+		IoReactor reactor(pool, backend);
+
+		int p[2];
+		REQUIRE(pipe(p) == 0);
+		Fd r(p[0]);
+		Fd w(p[1]);
+
+		const size_t size = 1 << 20;
+		REQUIRE(size > (size_t)fcntl(w.get(), F_GETPIPE_SZ));
+		std::string data(size, 0);
+		for (size_t i = 0; i < size; i++) {
+			data[i] = (char)(i * 31);
+		}
+
+		// 写操作允许只写一部分(io_uring对管道就是这样)，剩下的接着写
+		std::atomic_bool writeFailed(false);
+		std::thread writer([&]() {
+			size_t sent = 0;
+			while (sent < size) {
+				ssize_t n = reactor.asyncWrite(w.get(), data.data() + sent, size - sent).get();
+				if (n <= 0) {
+					writeFailed = true;
+					return;
+				}
+				sent += (size_t)n;
+			}
+			});
+
+		std::string received(size, 0);
+		size_t got = 0;
+		while (got < size) {
+			ssize_t n = reactor.asyncRead(r.get(), &received[got], size - got).get();
+			if (n <= 0) {
+				break;
+			}
+			got += (size_t)n;
+		}
+		writer.join();
+		CHECK(!writeFailed);
+		CHECK(got == size);
+		CHECK(received == data);
+	}
+}
+
+TEST_CASE(io_many_concurrent_reads)
+{
+	std::mt19937_64 rng(testSeed());
+	const int count = 500;
+
+	for (IoBackend backend : TEST_BACKENDS) {
+		ThreadPool pool;
+		pool.start(4);
+		IoReactor reactor(pool, backend);
+
+		std::vector<std::unique_ptr<Fd>> fds;
+		std::vector<std::future<ssize_t>> results;
+		std::vector<char> bufs(count);
+		for (int i = 0; i < count; i++) {
+			int p[2];
+			REQUIRE(pipe(p) == 0);
+			fds.emplace_back(new Fd(p[0]));
+			fds.emplace_back(new Fd(p[1]));
+			results.emplace_back(reactor.asyncRead(p[0], &bufs[i], 1));
+		}
+
+		// 按随机顺序写入
+		std::vector<int> order(count);
+		std::iota(order.begin(), order.end(), 0);
+		std::shuffle(order.begin(), order.end(), rng);
+		for (int i : order) {
+			char c = (char)('a' + i % 26);
+			CHECK(write(fds[2 * i + 1]->get(), &c, 1) == 1);
+		}
+
+		for (int i = 0; i < count; i++) {
+			CHECK(results[i].get() == 1);
+			CHECK(bufs[i] == (char)('a' + i % 26));
+		}
+	}
+}
+
+TEST_CASE(io_loopback_socket)
+{
+	for (IoBackend backend : TEST_BACKENDS) {
+		ThreadPool pool;
+		pool.start(2);
+		IoReactor reactor(pool, backend);
+
+		Fd listener(socket(AF_INET, SOCK_STREAM, 0));
+		REQUIRE(listener.get() >= 0);
+		sockaddr_in addr{};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+		socklen_t addrLen = sizeof(addr);
+		REQUIRE(bind(listener.get(), (sockaddr*)&addr, sizeof(addr)) == 0);
+		REQUIRE(listen(listener.get(), 16) == 0);
+		REQUIRE(getsockname(listener.get(), (sockaddr*)&addr, &addrLen) == 0);
+
+		auto accepted = reactor.asyncAccept(listener.get());
+		Fd client(socket(AF_INET, SOCK_STREAM, 0));
+		REQUIRE(connect(client.get(), (sockaddr*)&addr, sizeof(addr)) == 0);
+		Fd server((int)accepted.get());
+		REQUIRE(server.get() >= 0);
+
+		// 双向收发
+		char buf[8] = { 0 };
+		auto serverRead = reactor.asyncRead(server.get(), buf, 4);
+		CHECK(reactor.asyncWrite(client.get(), "pong", 4).get() == 4);
+		CHECK(serverRead.get() == 4);
+		CHECK(std::string(buf, 4) == "pong");
+
+		char reply[8] = { 0 };
+		auto replyRead = reactor.asyncRead(client.get(), reply, 2);
+		CHECK(reactor.asyncWrite(server.get(), "ok", 2).get() == 2);
+		CHECK(replyRead.get() == 2);
+		CHECK(std::string(reply, 2) == "ok");
+	}
+}
+
+TEST_CASE(io_cancel_on_destroy)
+{
+	for (IoBackend backend : TEST_BACKENDS) {
+		ThreadPool pool;
+		pool.start(2);
+
+		int p[2];
+		REQUIRE(pipe(p) == 0);
+		Fd r(p[0]), w(p[1]);
+
+		std::promise<ssize_t> cancelled;
+		char c;
+		{
+			IoReactor reactor(pool, backend);
+			reactor.asyncRead(r.get(), &c, 1, -1, [&cancelled](ssize_t res) { cancelled.set_value(res); });
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		auto result = cancelled.get_future();
+		REQUIRE(result.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+		CHECK(result.get() == -ECANCELED);
+	}
+}
+
+TEST_CASE(io_cancel_more_than_ring)
+{
+	// 未完成的操作比提交队列还多，取消请求一次发不完，析构时要分批发出并等到所有操作结束
+	for (IoBackend backend : TEST_BACKENDS) {
+		ThreadPool pool;
+		pool.start(2);
+
+		int p[2];
+		REQUIRE(pipe(p) == 0);
+		Fd r(p[0]), w(p[1]);
+
+		const int count = 2 * (int)IO_URING_ENTRIES + 1;
+		std::vector<char> bufs(count);
+		std::atomic_int cancelled(0);
+		std::atomic_int finished(0);
+		{
+			IoReactor reactor(pool, backend);
+			for (int i = 0; i < count; i++) {
+				reactor.asyncRead(r.get(), &bufs[i], 1, -1, [&](ssize_t res) {
+					if (res == -ECANCELED) {
+						cancelled++;
+					}
+					finished++;
+					});
+			}
+		}
+
+		// 回调可能还在线程池里排队
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (finished < count && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		CHECK(finished == count);
+		CHECK(cancelled == count);
+	}
+}
+
+TEST_CASE(io_pool_rejects)
+{
+	// 线程池队列一个任务也放不下：完成回调在I/O线程上直接执行，不会丢失
+	for (IoBackend backend : TEST_BACKENDS) {
+		ThreadPool pool;
+		pool.setTaskQueMaxThreshHold(0);
+		pool.start(2);
+		IoReactor reactor(pool, backend);
+
+		char path[] = "/tmp/thread_pool_io_XXXXXX";
+		Fd file(mkstemp(path));
+		REQUIRE(file.get() >= 0);
+		unlink(path);
+		CHECK(reactor.asyncWrite(file.get(), "rejected", 8, 0).get() == 8);
+
+		int p[2];
+		REQUIRE(pipe(p) == 0);
+		Fd r(p[0]);
+		Fd w(p[1]);
+		char buf[16] = { 0 };
+		auto pending = reactor.asyncRead(r.get(), buf, sizeof(buf));
+		CHECK(reactor.asyncWrite(w.get(), "ping", 4).get() == 4);
+		CHECK(pending.wait_for(std::chrono::seconds(5)) == std::future_status::ready && pending.get() == 4);
+		CHECK(std::string(buf) == "ping");
+	}
+}
+
+TEST_CASE(io_epoll_setup_failure_throws)
+{
+	ThreadPool pool;
+	pool.start(1);
+
+	// 把fd上限压到当前已用的数量，epoll_create1/eventfd都会失败
+	rlimit old;
+	REQUIRE(getrlimit(RLIMIT_NOFILE, &old) == 0);
+	int next = dup(0);
+	REQUIRE(next >= 0);
+	close(next);
+	rlimit low = old;
+	low.rlim_cur = (rlim_t)next;
+	REQUIRE(setrlimit(RLIMIT_NOFILE, &low) == 0);
+
+	bool thrown = false;
+	try {
+		IoReactor reactor(pool, IO_BACKEND_EPOLL);
+	}
+	catch (const std::system_error& e) {
+		thrown = e.code().value() == EMFILE;
+	}
+	REQUIRE(setrlimit(RLIMIT_NOFILE, &old) == 0);
+	CHECK(thrown);
+
+	// 恢复之后可以正常建立
+	IoReactor reactor(pool, IO_BACKEND_EPOLL);
+	CHECK(reactor.getBackend() == IO_BACKEND_EPOLL);
+}
@@ -0,0 +1,100 @@
+﻿// 原始线程池(thread_pool目录)的回归测试：Result的生命周期、多个线程池、关闭
+// 原始线程池每个任务都会往std::cout打印日志，这里只看测试框架的输出
+#include "test_harness.h"
+
+#include "thread_pool.h"
+
+namespace {
+
+	// 求和任务 可选地先睡一会，让Result先于任务执行结束被析构
+	class SumTask : public Task {
+	public:
+		SumTask(int begin, int end, int sleepMs, std::atomic_int* executed)
+			: begin_(begin)
+			, end_(end)
+			, sleepMs_(sleepMs)
+			, executed_(executed)
+		{}
+
+		Any run()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs_));
+			long long sum = 0;
+			for (int i = begin_; i <= end_; i++) {
+				sum += i;
+			}
+			if (executed_ != nullptr) {
+				(*executed_)++;
+			}
+			return sum;
+		}
+
+	private:
+		int begin_;
+		int end_;
+		int sleepMs_;
+		std::atomic_int* executed_;
+	};
+}
+
+TEST_CASE(legacy_results)
+{
+	ThreadPool pool;
+	pool.start(4);
+
+	Result res1 = pool.submitTask(std::make_shared<SumTask>(1, 100, 0, nullptr));
+	Result res2 = pool.submitTask(std::make_shared<SumTask>(101, 200, 0, nullptr));
+	Result res3 = pool.submitTask(std::make_shared<SumTask>(201, 300, 0, nullptr));
+
+	long long sum = res1.get().cast_<long long>() + res2.get().cast_<long long>() + res3.get().cast_<long long>();
+	CHECK(sum == 300LL * 301 / 2);
+}
+
+// 用户丢弃Result后任务才执行完，返回值写入共享状态而不是已经析构的Result
+TEST_CASE(legacy_discarded_result)
+{
+	std::atomic_int executed(0);
+	{
+		ThreadPool pool;
+		pool.start(2);
+		for (int i = 0; i < 8; i++) {
+			pool.submitTask(std::make_shared<SumTask>(1, 10, 5, &executed));
+		}
+	}
+	CHECK(executed == 8);
+}
+
+// 线程编号是全局递增的，第二个线程池的编号不从0开始
+TEST_CASE(legacy_multiple_pools)
+{
+	for (int round = 0; round < 3; round++) {
+		ThreadPool a;
+		ThreadPool b;
+		a.start(2);
+		b.start(3);
+
+		Result ra = a.submitTask(std::make_shared<SumTask>(1, 10, 0, nullptr));
+		Result rb = b.submitTask(std::make_shared<SumTask>(1, 20, 0, nullptr));
+		CHECK(ra.get().cast_<long long>() == 55);
+		CHECK(rb.get().cast_<long long>() == 210);
+	}
+}
+
+TEST_CASE(legacy_cached_mode)
+{
+	std::atomic_int executed(0);
+	{
+		ThreadPool pool;
+		pool.setMode(MODE_CACHED);
+		pool.start(2);
+
+		std::vector<std::unique_ptr<Result>> results;
+		for (int i = 0; i < 16; i++) {
+			results.emplace_back(new Result(pool.submitTask(std::make_shared<SumTask>(0, i, 2, &executed))));
+		}
+		for (int i = 0; i < 16; i++) {
+			CHECK(results[i]->get().cast_<long long>() == (long long)i * (i + 1) / 2);
+		}
+	}
+	CHECK(executed == 16);
+}
@@ -0,0 +1,192 @@
+﻿// 并行算法测试：与std串行版本对照，覆盖空区间、小区间、跨多块的大区间、非连续存储和队列满时的拒绝
+#include "test_harness.h"
+
+#include "parallel_algorithm.h"
+
+#include <deque>
+#include <string>
+
+namespace {
+
+	const size_t TEST_SIZES[] = { 0, 1, 2, 7, 1000, 100000, (1 << 20) + 13 };
+
+	std::vector<long long> randomData(std::mt19937_64& rng, size_t n, long long range)
+	{
+		std::vector<long long> data(n);
+		for (auto& x : data) {
+			x = (long long)(rng() % (uint64_t)range);
+		}
+		return data;
+	}
+}
+
+TEST_CASE(parallel_for_and_transform)
+{
+	std::mt19937_64 rng(testSeed());
+	for (int threads : { 1, 4 }) {
+		ThreadPool pool;
+		pool.start(threads);
+
+		for (size_t n : TEST_SIZES) {
+			std::vector<int> hits(n, 0);
+			parallel_for(pool, (size_t)0, n, [&](size_t i) { hits[i]++; });
+			CHECK(std::count(hits.begin(), hits.end(), 1) == (long)n);
+
+			auto input = randomData(rng, n, 1000000);
+			std::vector<long long> expected(n), out(n);
+			auto op = [](long long x) { return x * 7 - 3; };
+			std::transform(input.begin(), input.end(), expected.begin(), op);
+			auto end = parallel_transform(pool, input.begin(), input.end(), out.begin(), op);
+			CHECK(end == out.end());
+			CHECK(out == expected);
+		}
+	}
+}
+
+TEST_CASE(parallel_find_if_first_match)
+{
+	std::mt19937_64 rng(testSeed() + 1);
+	ThreadPool pool;
+	pool.start(4);
+
+	for (size_t n : TEST_SIZES) {
+		std::vector<int> data(n, 0);
+		auto pred = [](int x) { return x == 1; };
+		CHECK(parallel_find_if(pool, data.begin(), data.end(), pred) == data.end());
+		if (n == 0) {
+			continue;
+		}
+
+		// 多个匹配时必须返回第一个
+		for (int trial = 0; trial < 5; trial++) {
+			std::fill(data.begin(), data.end(), 0);
+			size_t first = rng() % n;
+			data[first] = 1;
+			for (int k = 0; k < 3; k++) {
+				data[first + rng() % (n - first)] = 1;
+			}
+			CHECK(parallel_find_if(pool, data.begin(), data.end(), pred) - data.begin() == (long)first);
+		}
+	}
+}
+
+TEST_CASE(parallel_inclusive_scan_matches_std)
+{
+	std::mt19937_64 rng(testSeed() + 2);
+	ThreadPool pool;
+	pool.start(4);
+
+	for (size_t n : TEST_SIZES) {
+		auto input = randomData(rng, n, 1000);
+		std::vector<long long> expected(n), out(n);
+		std::partial_sum(input.begin(), input.end(), expected.begin());
+		CHECK(parallel_inclusive_scan(pool, input.begin(), input.end(), out.begin()) == out.end());
+		CHECK(out == expected);
+
+		// 非加法的结合运算
+		auto maxOp = [](long long a, long long b) { return std::max(a, b); };
+		std::partial_sum(input.begin(), input.end(), expected.begin(), maxOp);
+		parallel_inclusive_scan(pool, input.begin(), input.end(), out.begin(), maxOp);
+		CHECK(out == expected);
+	}
+}
+
+TEST_CASE(parallel_sort_matches_std)
+{
+	std::mt19937_64 rng(testSeed() + 3);
+	for (int threads : { 1, 3, 4 }) {
+		ThreadPool pool;
+		pool.start(threads);
+
+		for (size_t n : TEST_SIZES) {
+			// 大量重复元素
+			auto data = randomData(rng, n, n / 4 + 1);
+			auto expected = data;
+			std::sort(expected.begin(), expected.end());
+			parallel_sort(pool, data.begin(), data.end());
+			CHECK(data == expected);
+
+			std::sort(expected.begin(), expected.end(), std::greater<>());
+			parallel_sort(pool, data.begin(), data.end(), std::greater<>());
+			CHECK(data == expected);
+		}
+	}
+}
+
+TEST_CASE(parallel_sort_non_trivial_and_deque)
+{
+	std::mt19937_64 rng(testSeed() + 4);
+	ThreadPool pool;
+	pool.start(4);
+
+	std::vector<std::string> words(200000);
+	for (auto& w : words) {
+		w = std::to_string(rng() % 100000);
+	}
+	auto expected = words;
+	std::sort(expected.begin(), expected.end());
+	parallel_sort(pool, words.begin(), words.end());
+	CHECK(words == expected);
+
+	auto data = randomData(rng, 300000, 1 << 30);
+	std::deque<long long> dq(data.begin(), data.end());
+	std::sort(data.begin(), data.end());
+	parallel_sort(pool, dq.begin(), dq.end());
+	CHECK(std::equal(dq.begin(), dq.end(), data.begin(), data.end()));
+}
+
+// 队列放不下的块必须由调用线程执行，不能当作已经完成
+TEST_CASE(parallel_algorithms_on_bounded_queue)
+{
+	std::mt19937_64 rng(testSeed() + 5);
+
+	auto checkAll = [&](ThreadPool& pool) {
+		auto input = randomData(rng, 1 << 20, 1000);
+		std::vector<long long> expected(input.size()), out(input.size(), -1);
+		auto op = [](long long x) { return x * 7 - 3; };
+		std::transform(input.begin(), input.end(), expected.begin(), op);
+		parallel_transform(pool, input.begin(), input.end(), out.begin(), op);
+		CHECK(out == expected);
+
+		std::partial_sum(input.begin(), input.end(), expected.begin());
+		parallel_inclusive_scan(pool, input.begin(), input.end(), out.begin());
+		CHECK(out == expected);
+
+		std::vector<int> flags(input.size(), 0);
+		flags[flags.size() - 10] = 1;
+		CHECK(parallel_find_if(pool, flags.begin(), flags.end(), [](int x) { return x == 1; }) - flags.begin() == (long)flags.size() - 10);
+
+		auto data = input;
+		std::sort(input.begin(), input.end());
+		parallel_sort(pool, data.begin(), data.end());
+		CHECK(data == input);
+	};
+
+	// 队列容量为0 所有块都在调用线程上执行
+	{
+		ThreadPool pool;
+		pool.setTaskQueMaxThreshHold(0);
+		pool.start(2);
+		checkAll(pool);
+	}
+
+	// 唯一的工作线程被占住，队列只能放下4个块，其余的块被拒绝
+	{
+		ThreadPool pool;
+		pool.setTaskQueMaxThreshHold(4);
+		pool.start(1);
+
+		std::promise<void> started;
+		std::promise<void> gate;
+		auto blocker = pool.submitTask([&]() { started.set_value(); gate.get_future().wait(); });
+		started.get_future().wait();
+
+		std::thread opener([&]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			gate.set_value();
+			});
+		checkAll(pool);
+		opener.join();
+		blocker.get();
+	}
+}
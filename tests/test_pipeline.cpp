@@ -0,0 +1,178 @@
+﻿// Pipeline测试：有序输出、令牌上限、串行阶段不并发、异常传播、run()之后立即析构、线程池拒绝任务
+#include "test_harness.h"
+
+#include "pipeline.h"
+
+#include <string>
+#include <stdexcept>
+
+TEST_CASE(pipeline_in_order_output)
+{
+	std::mt19937_64 rng(testSeed());
+	ThreadPool pool;
+	pool.start(4);
+
+	for (size_t maxTokens : { 1, 3, 16 }) {
+		const int count = 2000;
+		std::vector<int> delays(count);
+		for (auto& d : delays) {
+			d = (int)(rng() % 50);
+		}
+
+		Pipeline pipeline(pool, maxTokens);
+		std::vector<int> out;
+		std::atomic_int inflight(0);
+		std::atomic_int maxInflight(0);
+		int next = 0;
+
+		pipeline.addStage<int>(STAGE_PARALLEL, [&](int x) {
+			// 随机耗时 让并行阶段乱序完成
+			volatile int sink = 0;
+			for (int k = 0; k < delays[x] * 20; k++) {
+				sink += k;
+			}
+			return std::to_string(x);
+			})
+			.addStage<std::string>(STAGE_SERIAL_IN_ORDER, [&](const std::string& s) {
+				out.push_back(std::stoi(s));
+				inflight--;
+			});
+
+		pipeline.run([&](FlowControl& fc) {
+			if (next == count) {
+				fc.stop();
+				return 0;
+			}
+			int cur = ++inflight;
+			int old = maxInflight;
+			while (cur > old && !maxInflight.compare_exchange_weak(old, cur)) {
+			}
+			return next++;
+			});
+
+		REQUIRE(out.size() == (size_t)count);
+		for (int i = 0; i < count; i++) {
+			CHECK(out[i] == i);
+		}
+		CHECK(maxInflight <= (int)maxTokens);
+	}
+}
+
+TEST_CASE(pipeline_serial_out_of_order)
+{
+	ThreadPool pool;
+	pool.start(4);
+	Pipeline pipeline(pool, 8);
+
+	std::atomic_int inside(0);
+	std::atomic_bool overlapped(false);
+	std::vector<int> seen;
+	int next = 0;
+
+	pipeline.addStage<int>(STAGE_PARALLEL, [](int x) { return x * 3; })
+		.addStage<int>(STAGE_SERIAL_OUT_OF_ORDER, [&](int x) {
+			if (inside++ != 0) {
+				overlapped = true;
+			}
+			seen.push_back(x);
+			inside--;
+			return x;
+			})
+		.addStage<int>(STAGE_PARALLEL, [](int) {});
+
+	pipeline.run([&](FlowControl& fc) {
+		if (next == 1000) {
+			fc.stop();
+		}
+		return next++;
+		});
+
+	CHECK(!overlapped);
+	REQUIRE(seen.size() == 1000);
+	std::sort(seen.begin(), seen.end());
+	for (int i = 0; i < 1000; i++) {
+		CHECK(seen[i] == i * 3);
+	}
+}
+
+TEST_CASE(pipeline_exception_propagates)
+{
+	ThreadPool pool;
+	pool.start(2);
+	Pipeline pipeline(pool, 4);
+
+	int next = 0;
+	std::atomic_int reached(0);
+	pipeline.addStage<int>(STAGE_PARALLEL, [](int x) {
+		if (x == 50) {
+			throw std::runtime_error("boom");
+		}
+		return x;
+		})
+		.addStage<int>(STAGE_SERIAL_IN_ORDER, [&](int) { reached++; });
+
+	bool thrown = false;
+	try {
+		pipeline.run([&](FlowControl& fc) {
+			if (next == 1000) {
+				fc.stop();
+			}
+			return next++;
+			});
+	}
+	catch (const std::runtime_error& e) {
+		thrown = std::string(e.what()) == "boom";
+	}
+	CHECK(thrown);
+	CHECK(reached < 1000);
+}
+
+TEST_CASE(pipeline_destroy_after_run)
+{
+	// run()返回后立刻析构，最后一个任务不能再访问流水线
+	ThreadPool pool;
+	pool.start(4);
+
+	for (int round = 0; round < 200 * testIterations(); round++) {
+		auto pipeline = std::make_unique<Pipeline>(pool, 4);
+		std::atomic_int sum(0);
+		int next = 0;
+		pipeline->addStage<int>(STAGE_PARALLEL, [](int x) { return x + 1; })
+			.addStage<int>(STAGE_SERIAL_OUT_OF_ORDER, [&](int x) { sum += x; });
+
+		pipeline->run([&](FlowControl& fc) {
+			if (next == 8) {
+				fc.stop();
+			}
+			return next++;
+			});
+		pipeline.reset();
+		CHECK(sum == 36);
+	}
+}
+
+TEST_CASE(pipeline_pool_rejects)
+{
+	// 线程池队列一个任务也放不下：所有阶段都在投递者线程上执行，run()照样结束
+	ThreadPool pool;
+	pool.setTaskQueMaxThreshHold(0);
+	pool.start(2);
+
+	Pipeline pipeline(pool, 4);
+	std::vector<int> out;
+	int next = 0;
+	pipeline.addStage<int>(STAGE_PARALLEL, [](int x) { return x * 2; })
+		.addStage<int>(STAGE_SERIAL_IN_ORDER, [&](int x) { out.push_back(x); });
+
+	pipeline.run([&](FlowControl& fc) {
+		if (next == 100) {
+			fc.stop();
+		}
+		return next++;
+		});
+
+	REQUIRE(out.size() == 100);
+	for (int i = 0; i < 100; i++) {
+		CHECK(out[i] == i * 2);
+	}
+}
@@ -0,0 +1,345 @@
+﻿// 队列测试：BoundedQueue(无锁MPMC)和RingQueuePolicy的环形队列
+// 顺序语义对照std::deque检查，并发语义用线性一致性检查，BoundedQueue另外在确定性调度下探索交错执行
+// 确定性调度的头文件必须最先包含，它定义了被测头文件里的调度点
+#include "deterministic_scheduler.h"
+#include "test_harness.h"
+#include "linearizability.h"
+
+#include "bounded_queue.h"
+#include "thread_pool_policy.h"
+
+#include <mutex>
+#include <thread>
+#include <memory>
+
+namespace {
+
+	const int HISTORY_THREADS = 3; // 每轮历史的线程数
+	const int HISTORY_OPS = 4; // 每个线程的操作数
+
+	// RingQueuePolicy的队列本身不加锁，线程池总是在taskQueMtx_下、检查容量之后才push，这里按同样的方式使用
+	template<size_t Capacity>
+	class LockedRingQueue {
+	public:
+		bool tryPush(int value)
+		{
+			std::unique_lock<std::mutex> lock(mtx_);
+			if (que_.size() >= Capacity) {
+				return false;
+			}
+			que_.push(std::move(value));
+			return true;
+		}
+
+		bool tryPop(int& value)
+		{
+			std::unique_lock<std::mutex> lock(mtx_);
+			if (que_.empty()) {
+				return false;
+			}
+			value = que_.pop();
+			return true;
+		}
+
+	private:
+		std::mutex mtx_;
+		typename RingQueuePolicy<Capacity>::template Queue<int> que_;
+	};
+
+	// 随机生成每个线程要执行的操作序列
+	std::vector<std::vector<QueueOpType>> makePlan(std::mt19937_64& rng)
+	{
+		std::vector<std::vector<QueueOpType>> plan(HISTORY_THREADS);
+		for (auto& ops : plan) {
+			for (int i = 0; i < HISTORY_OPS; i++) {
+				ops.push_back(rng() % 2 == 0 ? QUEUE_PUSH : QUEUE_POP);
+			}
+		}
+		return plan;
+	}
+
+	// 执行一个线程的操作并记录历史，push的值在整个历史中唯一
+	template<typename Queue>
+	void runOps(Queue& que, HistoryClock& clock, int thread, const std::vector<QueueOpType>& ops, std::vector<QueueOp>& out)
+	{
+		for (size_t i = 0; i < ops.size(); i++) {
+			QueueOp op{ ops[i], thread * 100 + (int)i, false, 0, 0 };
+			op.invoke = clock.tick();
+			if (op.type == QUEUE_PUSH) {
+				op.ok = que.tryPush(op.value);
+			}
+			else {
+				int value = -1;
+				op.ok = que.tryPop(value);
+				op.value = value;
+			}
+			op.response = clock.tick();
+			out.push_back(op);
+		}
+	}
+
+	std::vector<QueueOp> merge(const std::vector<std::vector<QueueOp>>& perThread)
+	{
+		std::vector<QueueOp> history;
+		for (auto& ops : perThread) {
+			history.insert(history.end(), ops.begin(), ops.end());
+		}
+		return history;
+	}
+
+	// 真实线程并发执行一轮历史
+	template<typename Queue>
+	std::vector<QueueOp> runConcurrent(Queue& que, const std::vector<std::vector<QueueOpType>>& plan)
+	{
+		HistoryClock clock;
+		std::vector<std::vector<QueueOp>> perThread(plan.size());
+		std::atomic_int ready(0);
+
+		std::vector<std::thread> threads;
+		for (size_t t = 0; t < plan.size(); t++) {
+			threads.emplace_back([&, t]() {
+				// 所有线程就位后一起开始，尽量让操作重叠
+				ready++;
+				while (ready < (int)plan.size()) {
+					std::this_thread::yield();
+				}
+				runOps(que, clock, (int)t, plan[t], perThread[t]);
+				});
+		}
+		for (auto& th : threads) {
+			th.join();
+		}
+		return merge(perThread);
+	}
+
+	// 顺序执行随机操作，与std::deque对照
+	template<typename Queue>
+	void checkAgainstModel(Queue& que, size_t capacity, std::mt19937_64& rng, int steps)
+	{
+		std::deque<int> model;
+		for (int i = 0; i < steps; i++) {
+			if (rng() % 2 == 0) {
+				bool ok = que.tryPush(i);
+				CHECK(ok == (model.size() < capacity));
+				if (ok) {
+					model.push_back(i);
+				}
+			}
+			else {
+				int value = -1;
+				bool ok = que.tryPop(value);
+				CHECK(ok == !model.empty());
+				if (ok) {
+					CHECK(value == model.front());
+					model.pop_front();
+				}
+			}
+		}
+	}
+
+	void printHistory(const std::vector<QueueOp>& history)
+	{
+		for (auto& op : history) {
+			std::cerr << "  [" << op.invoke << ", " << op.response << "] "
+				<< (op.type == QUEUE_PUSH ? "push " : "pop ") << op.value << (op.ok ? " ok" : " fail") << std::endl;
+		}
+	}
+}
+
+TEST_CASE(bounded_queue_sequential)
+{
+	std::mt19937_64 rng(testSeed());
+
+	BoundedQueue<int> que(5);
+	CHECK(que.capacity() == 8);
+	CHECK(que.empty());
+	checkAgainstModel(que, que.capacity(), rng, 10000);
+
+	// 只能移动的元素
+	BoundedQueue<std::unique_ptr<int>> ptrQue(4);
+	CHECK(ptrQue.tryPush(std::make_unique<int>(7)));
+	std::unique_ptr<int> p;
+	CHECK(ptrQue.tryPop(p) && p != nullptr && *p == 7);
+	CHECK(!ptrQue.tryPop(p));
+
+	// 入队失败时不能移走数据，调用者还要重试
+	for (int i = 0; i < 4; i++) {
+		CHECK(ptrQue.tryPush(std::make_unique<int>(i)));
+	}
+	p = std::make_unique<int>(9);
+	CHECK(!ptrQue.tryPush(std::move(p)));
+	CHECK(p != nullptr && *p == 9);
+}
+
+TEST_CASE(bounded_queue_linearizable_stress)
+{
+	std::mt19937_64 rng(testSeed());
+	int rounds = 300 * testIterations();
+
+	for (int r = 0; r < rounds; r++) {
+		// 容量为2，满和空都经常出现
+		BoundedQueue<int> que(2);
+		std::vector<QueueOp> history = runConcurrent(que, makePlan(rng));
+		if (!QueueLinearizabilityChecker(history, que.capacity(), true).check()) {
+			std::cerr << "not linearizable, round " << r << std::endl;
+			printHistory(history);
+			REQUIRE(false);
+		}
+	}
+}
+
+TEST_CASE(bounded_queue_deterministic)
+{
+	int rounds = 2000 * testIterations();
+
+	for (int r = 0; r < rounds; r++) {
+		uint64_t seed = testSeed() + r;
+		std::mt19937_64 rng(seed);
+		auto plan = makePlan(rng);
+
+		BoundedQueue<int> que(2);
+		HistoryClock clock;
+		std::vector<std::vector<QueueOp>> perThread(plan.size());
+		std::vector<std::function<void()>> funcs;
+		for (size_t t = 0; t < plan.size(); t++) {
+			funcs.emplace_back([&, t]() { runOps(que, clock, (int)t, plan[t], perThread[t]); });
+		}
+
+		DeterministicScheduler sched(seed);
+		bool finished = sched.run(funcs);
+		std::vector<QueueOp> history = merge(perThread);
+		if (!finished || !QueueLinearizabilityChecker(history, que.capacity(), true).check()) {
+			std::cerr << (finished ? "not linearizable" : "livelock") << ", schedule seed " << seed << std::endl;
+			printHistory(history);
+			REQUIRE(false);
+		}
+	}
+}
+
+// 没有并发冲突时不允许假失败
+TEST_CASE(bounded_queue_quiescent_is_exact)
+{
+	BoundedQueue<int> que(2);
+	std::vector<QueueOp> history;
+	HistoryClock clock;
+	std::vector<QueueOpType> ops = { QUEUE_POP, QUEUE_PUSH, QUEUE_PUSH, QUEUE_PUSH, QUEUE_POP, QUEUE_POP, QUEUE_POP };
+	runOps(que, clock, 0, ops, history);
+	CHECK(QueueLinearizabilityChecker(history, que.capacity(), false).check());
+
+	// 检查器自身：顺序历史中错误的结果必须被拒绝
+	std::vector<QueueOp> bad = {
+		{ QUEUE_PUSH, 1, true, 0, 1 },
+		{ QUEUE_POP, -1, false, 2, 3 },
+	};
+	CHECK(!QueueLinearizabilityChecker(bad, 4, true).check());
+	std::vector<QueueOp> reordered = {
+		{ QUEUE_PUSH, 1, true, 0, 1 },
+		{ QUEUE_PUSH, 2, true, 2, 3 },
+		{ QUEUE_POP, 2, true, 4, 5 },
+	};
+	CHECK(!QueueLinearizabilityChecker(reordered, 4, true).check());
+}
+
+TEST_CASE(bounded_queue_mpmc_stress)
+{
+	const int producers = 4;
+	const int consumers = 4;
+	const int perProducer = 20000 * testIterations();
+
+	BoundedQueue<int> que(64);
+	std::vector<std::atomic_int> seen(producers * perProducer);
+	std::atomic_int consumed(0);
+	std::atomic_bool orderOk(true);
+
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([&, p]() {
+			for (int i = 0; i < perProducer; i++) {
+				while (!que.tryPush(p * perProducer + i)) {
+					std::this_thread::yield();
+				}
+			}
+			});
+	}
+	for (int c = 0; c < consumers; c++) {
+		threads.emplace_back([&]() {
+			// 同一个消费者看到的同一生产者的数据必须是递增的
+			std::vector<int> last(producers, -1);
+			while (consumed < producers * perProducer) {
+				int value;
+				if (!que.tryPop(value)) {
+					std::this_thread::yield();
+					continue;
+				}
+				consumed++;
+				seen[value]++;
+				int p = value / perProducer;
+				if (value <= last[p]) {
+					orderOk = false;
+				}
+				last[p] = value;
+			}
+			});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+
+	CHECK(orderOk);
+	CHECK(que.empty());
+	for (auto& s : seen) {
+		if (s != 1) {
+			CHECK(s == 1);
+			break;
+		}
+	}
+}
+
+TEST_CASE(ring_queue_sequential)
+{
+	std::mt19937_64 rng(testSeed());
+
+	// 单独检查环形下标的回绕
+	typename RingQueuePolicy<7>::template Queue<int> que;
+	CHECK(que.capacity == 7);
+	for (int round = 0; round < 10; round++) {
+		for (int i = 0; i < 5; i++) {
+			que.push(round * 10 + i);
+		}
+		for (int i = 0; i < 5; i++) {
+			CHECK(que.pop() == round * 10 + i);
+		}
+	}
+	CHECK(que.empty() && que.size() == 0);
+
+	LockedRingQueue<7> locked;
+	checkAgainstModel(locked, 7, rng, 10000);
+
+	// 只能移动的任务类型，与TaskStorageSize非0时线程池使用的一样
+	typename RingQueuePolicy<4>::template Queue<InplaceTask<64>> tasks;
+	int sum = 0;
+	for (int i = 1; i <= 4; i++) {
+		tasks.push(InplaceTask<64>([&sum, i]() { sum += i; }));
+	}
+	while (!tasks.empty()) {
+		tasks.pop()();
+	}
+	CHECK(sum == 10);
+}
+
+TEST_CASE(ring_queue_linearizable_stress)
+{
+	std::mt19937_64 rng(testSeed());
+	int rounds = 300 * testIterations();
+
+	for (int r = 0; r < rounds; r++) {
+		// 在锁保护下使用，不允许假失败
+		LockedRingQueue<2> que;
+		std::vector<QueueOp> history = runConcurrent(que, makePlan(rng));
+		if (!QueueLinearizabilityChecker(history, 2, false).check()) {
+			std::cerr << "not linearizable, round " << r << std::endl;
+			printHistory(history);
+			REQUIRE(false);
+		}
+	}
+}
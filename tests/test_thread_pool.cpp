@@ -0,0 +1,522 @@
+﻿// 线程池测试：提交/返回值、随机高并发压力、关闭、CACHED模式、队列满拒绝、字节数水位、编译期策略组合、线程注册表、任务内存池
+#include "deterministic_scheduler.h"
+#include "test_harness.h"
+
+#include "thread_pool_refactor.h"
+
+#include <string>
+#include <stdexcept>
+#include <array>
+
+namespace {
+
+	// 阻塞任务用的门闩 open之前所有wait都阻塞
+	class Gate {
+	public:
+		Gate() : future_(promise_.get_future().share()) {}
+		void open() { promise_.set_value(); }
+		void wait() const { future_.wait(); }
+
+	private:
+		std::promise<void> promise_;
+		std::shared_future<void> future_;
+	};
+
+	// 随机压力：随机线程数、随机模式、多个生产者同时提交随机数量的任务，任务里再随机提交子任务
+	// 线程池析构后检查每个任务恰好执行了一次
+	template<typename Pool>
+	void stressPool(std::mt19937_64& rng, bool nested)
+	{
+		int rounds = 20 * testIterations();
+		for (int r = 0; r < rounds; r++) {
+			int threads = 1 + (int)(rng() % 8);
+			int producers = 1 + (int)(rng() % 4);
+			bool cached = rng() % 2 == 0;
+			std::vector<int> perProducer(producers);
+			for (auto& n : perProducer) {
+				n = (int)(rng() % 500);
+			}
+
+			std::atomic_int expected(0);
+			std::atomic_int executed(0);
+			std::atomic_int sumOk(0);
+			{
+				Pool pool;
+				if (cached) {
+					pool.setMode(MODE_CACHED);
+					pool.setTaskQueSizeThreshHold(threads + 4);
+				}
+				pool.start(threads);
+
+				std::vector<std::thread> submitters;
+				for (int p = 0; p < producers; p++) {
+					uint64_t seed = rng();
+					submitters.emplace_back([&, p, seed]() {
+						std::mt19937_64 local(seed);
+						std::vector<std::future<int>> results;
+						for (int i = 0; i < perProducer[p]; i++) {
+							bool spawn = nested && local() % 8 == 0;
+							int spin = (int)(local() % 200);
+							expected += spawn ? 2 : 1;
+							results.emplace_back(pool.submitTask([&, spawn, spin](int x) {
+								volatile int sink = 0;
+								for (int k = 0; k < spin; k++) {
+									sink += k;
+								}
+								if (spawn) {
+									// 子任务的结果不等待，由线程池析构保证执行完
+									pool.submitTask([&]() { executed++; });
+								}
+								executed++;
+								return x * 2;
+								}, i));
+						}
+						for (int i = 0; i < (int)results.size(); i++) {
+							if (results[i].get() == i * 2) {
+								sumOk++;
+							}
+						}
+						});
+				}
+				for (auto& t : submitters) {
+					t.join();
+				}
+			} // 析构时等待队列中剩余的任务全部执行完
+
+			int total = 0;
+			for (int n : perProducer) {
+				total += n;
+			}
+			CHECK(sumOk == total);
+			CHECK(executed == expected);
+		}
+	}
+}
+
+TEST_CASE(pool_submit_results)
+{
+	ThreadPool pool;
+	pool.start(3);
+	CHECK(pool.getThreadSize() == 3);
+
+	auto a = pool.submitTask([](int x, int y) { return x + y; }, 1, 2);
+	auto b = pool.submitTask([](const std::string& s) { return s + "!"; }, std::string("hello"));
+	int side = 0;
+	auto c = pool.submitTask([&side]() { side = 42; });
+	auto d = pool.submitTask([]() -> int { throw std::runtime_error("boom"); });
+
+	CHECK(a.get() == 3);
+	CHECK(b.get() == "hello!");
+	c.get();
+	CHECK(side == 42);
+
+	bool thrown = false;
+	try {
+		d.get();
+	}
+	catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+
+TEST_CASE(pool_random_stress_default)
+{
+	std::mt19937_64 rng(testSeed());
+	stressPool<ThreadPool>(rng, true);
+}
+
+TEST_CASE(pool_random_stress_policies)
+{
+	std::mt19937_64 rng(testSeed() + 1);
+	stressPool<BasicThreadPool<DequeQueuePolicy, NotifyOneWakeup, CountingStats>>(rng, true);
+	stressPool<BasicThreadPool<DequeQueuePolicy, NotifyOneWakeup, NoStats, 128>>(rng, true);
+
+	// 有界队列上任务内部再提交可能全部工作线程都等在满队列上，只测试外部提交
+	stressPool<BasicThreadPool<RingQueuePolicy<16>, NotifyAllWakeup, NoStats, 128>>(rng, false);
+	stressPool<BasicThreadPool<RingQueuePolicy<64>, NotifyOneWakeup, CountingStats>>(rng, false);
+}
+
+TEST_CASE(pool_shutdown_drains_queue)
+{
+	std::mt19937_64 rng(testSeed() + 2);
+	int rounds = 50 * testIterations();
+
+	for (int r = 0; r < rounds; r++) {
+		int tasks = (int)(rng() % 1000);
+		std::atomic_int executed(0);
+		{
+			ThreadPool pool;
+			pool.start(1 + (int)(rng() % 4));
+			for (int i = 0; i < tasks; i++) {
+				pool.submitTask([&executed]() { executed++; });
+			}
+		}
+		CHECK(executed == tasks);
+	}
+
+	// 只创建不启动、启动后立刻析构
+	{
+		ThreadPool pool;
+	}
+	{
+		ThreadPool pool;
+		pool.start(4);
+	}
+}
+
+TEST_CASE(pool_cached_mode_grows)
+{
+	Gate gate;
+	ThreadPool pool;
+	pool.setMode(MODE_CACHED);
+	pool.setTaskQueSizeThreshHold(6);
+	pool.start(2);
+
+	std::vector<std::future<void>> results;
+	for (int i = 0; i < 20; i++) {
+		results.emplace_back(pool.submitTask([&gate]() { gate.wait(); }));
+	}
+
+	CHECK(pool.getThreadSize() > 2);
+	CHECK(pool.getThreadSize() <= 6);
+
+	gate.open();
+	for (auto& res : results) {
+		res.get();
+	}
+}
+
+// 工作线程运行期间修改模式和阈值 在TSan下检查没有数据竞争
+TEST_CASE(pool_reconfigure_while_running)
+{
+	ThreadPool pool;
+	pool.start(2);
+
+	std::atomic_bool stop(false);
+	std::thread toggler([&]() {
+		int i = 0;
+		while (!stop) {
+			pool.setMode(i % 2 == 0 ? MODE_CACHED : MODE_FIXED);
+			pool.setTaskQueSizeThreshHold(4 + i % 4);
+			pool.setTaskQueMaxThreshHold(1000 + i % 10);
+			i++;
+			std::this_thread::yield();
+		}
+		});
+
+	std::vector<std::future<int>> results;
+	for (int i = 0; i < 2000; i++) {
+		results.emplace_back(pool.submitTask([](int x) { return x; }, i));
+	}
+	for (int i = 0; i < (int)results.size(); i++) {
+		CHECK(results[i].get() == i);
+	}
+
+	stop = true;
+	toggler.join();
+	CHECK(pool.getThreadSize() <= 8);
+}
+
+TEST_CASE(pool_queue_full_rejects)
+{
+	Gate gate;
+	BasicThreadPool<DequeQueuePolicy, NotifyAllWakeup, CountingStats> pool;
+	pool.setTaskQueMaxThreshHold(1);
+	pool.start(1);
+
+	std::promise<void> started;
+	auto blocker = pool.submitTask([&]() { started.set_value(); gate.wait(); return 1; });
+	started.get_future().wait();
+
+	auto queued = pool.submitTask([]() { return 2; });
+	auto rejected = pool.submitTask([]() { return 3; }); // 队列已满 等待一秒后失败
+
+	// 被拒绝的任务返回默认值
+	CHECK(rejected.get() == 0);
+	CHECK(pool.getRejectedTaskCount() == 1);
+
+	// 不等待的提交直接返回无效的future，不计入拒绝数
+	bool ran = false;
+	auto tried = pool.trySubmitTask([&ran]() { ran = true; return 4; });
+	CHECK(!tried.valid());
+	CHECK(pool.getRejectedTaskCount() == 1);
+
+	gate.open();
+	CHECK(blocker.get() == 1);
+	CHECK(queued.get() == 2);
+	CHECK(pool.getSubmittedTaskCount() == 2);
+	CHECK(!ran);
+
+	// 队列有空位时与submitTask相同
+	auto accepted = pool.trySubmitTask([]() { return 5; });
+	CHECK(accepted.valid() && accepted.get() == 5);
+}
+
+TEST_CASE(pool_bytes_watermark_throttles)
+{
+	// 每个任务一个门闩 可以精确控制队列中剩下哪些任务
+	// 是否允许入队用trySubmitTask探测，不依赖等待时间
+	Gate gates[3];
+	ThreadPool pool;
+	pool.setTaskQueBytesThreshHold(1000, 300);
+	pool.start(1);
+
+	std::promise<void> started;
+	auto blocker = pool.submitTask([&]() { started.set_value(); gates[0].wait(); });
+	started.get_future().wait();
+
+	auto a = pool.submitTaskWithBytes(400, [&]() { gates[1].wait(); });
+	auto b = pool.submitTaskWithBytes(400, [&]() { gates[2].wait(); });
+	CHECK(pool.getTaskQueBytes() == 800);
+
+	// 超过高水位 进入暂停状态
+	std::array<char, 400> payload{};
+	CHECK(!pool.trySubmitTask([payload]() { return payload[0]; }).valid());
+
+	// 取走a之后还剩400字节，小任务虽然放得下但没有降到低水位，仍然不允许入队
+	gates[0].open();
+	while (pool.getTaskQueBytes() != 400) {
+		std::this_thread::yield();
+	}
+	CHECK(!pool.trySubmitTask([]() {}).valid());
+
+	// 阻塞的提交者在取走b、降到低水位以下后恢复，拿到的是任务真正的结果而不是被拒绝时的默认值
+	std::future<int> produced;
+	std::thread producer([&]() {
+		produced = pool.submitTaskWithBytes(400, []() { return 42; });
+		});
+	gates[1].open();
+	producer.join();
+	gates[2].open();
+	CHECK(produced.get() == 42);
+
+	blocker.get();
+	a.get();
+	b.get();
+	CHECK(pool.getTaskQueBytes() == 0);
+}
+
+TEST_CASE(pool_bytes_estimated_from_captures)
+{
+	Gate gate;
+	ThreadPool pool;
+	pool.start(1);
+
+	std::promise<void> started;
+	auto blocker = pool.submitTask([&]() { started.set_value(); gate.wait(); });
+	started.get_future().wait();
+
+	// 按值捕获的数据计入字节数
+	std::array<char, 4096> buffer{};
+	buffer[10] = 7;
+	auto big = pool.submitTask([buffer]() { return (int)buffer[10]; });
+	CHECK(pool.getTaskQueBytes() >= sizeof(buffer));
+
+	gate.open();
+	CHECK(big.get() == 7);
+	blocker.get();
+	CHECK(pool.getTaskQueBytes() == 0);
+}
+
+TEST_CASE(pool_future_outlives_pool)
+{
+	// 使用TaskArena时future的共享状态在arena中，线程池析构后仍然可以读取，arena等最后一个future释放才析构
+	auto arena = std::make_shared<TaskArena>();
+	for (bool useArena : { false, true }) {
+		std::future<std::string> result;
+		std::future<void> failed;
+		{
+			BasicThreadPool<DequeQueuePolicy, NotifyOneWakeup, NoStats, 128> pool;
+			if (useArena) {
+				pool.setTaskArena(arena);
+			}
+			pool.start(2);
+			result = pool.submitTask([](int n) { return std::string(n, 'x'); }, 100);
+			failed = pool.submitTask([]() { throw std::runtime_error("boom"); });
+		}
+		CHECK(result.get() == std::string(100, 'x'));
+		CHECK((arena->getAllocatedBytes() != 0) == useArena);
+
+		bool thrown = false;
+		try {
+			failed.get();
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+
+		// get()之后future不再引用共享状态，内存全部回到arena
+		CHECK(arena->getAllocatedBytes() == 0);
+	}
+}
+
+TEST_CASE(pool_ring_queue_blocks_producer)
+{
+	// 环形队列满了之后提交者等待而不是失败
+	BasicThreadPool<RingQueuePolicy<4>, NotifyOneWakeup, CountingStats, 128> pool;
+	pool.start(2);
+
+	std::vector<std::future<int>> results;
+	for (int i = 0; i < 1000; i++) {
+		results.emplace_back(pool.submitTask([](int x) { return x + 1; }, i));
+	}
+	for (int i = 0; i < (int)results.size(); i++) {
+		CHECK(results[i].get() == i + 1);
+	}
+	CHECK(pool.getRejectedTaskCount() == 0);
+	CHECK(pool.getSubmittedTaskCount() == 1000);
+}
+
+TEST_CASE(worker_registry_stress)
+{
+	const int capacity = 4;
+	WorkerRegistry registry(capacity);
+	std::vector<std::atomic_int> owners(capacity);
+	std::atomic_bool exclusive(true);
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 8; t++) {
+		threads.emplace_back([&]() {
+			for (int i = 0; i < 2000 * testIterations(); i++) {
+				int id = registry.claim();
+				if (id < 0) {
+					continue;
+				}
+				if (owners[id]++ != 0 || registry.getState(id) == WORKER_RETIRED) {
+					exclusive = false;
+				}
+				registry.setState(id, WORKER_RUNNING);
+				owners[id]--;
+				registry.retire(id);
+			}
+			});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+
+	CHECK(exclusive);
+	CHECK(registry.liveSize() == 0);
+	for (int i = 0; i < capacity; i++) {
+		CHECK(registry.getState(i) == WORKER_RETIRED);
+	}
+}
+
+TEST_CASE(worker_registry_deterministic)
+{
+	int rounds = 1000 * testIterations();
+	for (int r = 0; r < rounds; r++) {
+		uint64_t seed = testSeed() + r;
+
+		// 3个线程争抢2个槽位
+		WorkerRegistry registry(2);
+		int owners[2] = { 0, 0 };
+		int claimed = 0;
+		bool exclusive = true;
+
+		std::vector<std::function<void()>> funcs;
+		for (int t = 0; t < 3; t++) {
+			funcs.emplace_back([&]() {
+				for (int i = 0; i < 2; i++) {
+					int id = registry.claim();
+					if (id < 0) {
+						continue;
+					}
+					claimed++;
+					if (owners[id]++ != 0) {
+						exclusive = false;
+					}
+					THREAD_POOL_SCHED_POINT();
+					if (registry.liveSize() > 2) {
+						exclusive = false;
+					}
+					owners[id]--;
+					registry.retire(id);
+				}
+				});
+		}
+
+		DeterministicScheduler sched(seed);
+		bool finished = sched.run(funcs);
+		if (!finished || !exclusive || registry.liveSize() != 0 || claimed < 2) {
+			std::cerr << "registry failure, schedule seed " << seed << std::endl;
+			REQUIRE(false);
+		}
+	}
+}
+
+TEST_CASE(task_arena_recycles)
+{
+	TaskArena arena(2);
+
+	// 同一级别释放后再分配拿到同一块内存
+	void* p = arena.allocate(100);
+	CHECK(arena.getAllocatedBytes() == 128);
+	arena.deallocate(p, 100);
+	CHECK(arena.getAllocatedBytes() == 0);
+	CHECK(arena.getCachedBytes() == 128);
+	CHECK(arena.allocate(128) == p);
+	arena.deallocate(p, 128);
+
+	// 超过缓存上限的块还给系统
+	void* blocks[3];
+	for (auto& b : blocks) {
+		b = arena.allocate(64);
+	}
+	for (auto& b : blocks) {
+		arena.deallocate(b, 64);
+	}
+	CHECK(arena.getCachedBytes() == 128 + 2 * 64);
+
+	// 大块不缓存
+	void* big = arena.allocate(TaskArena::MAX_BLOCK_SIZE + 1);
+	CHECK(arena.getAllocatedBytes() == TaskArena::MAX_BLOCK_SIZE + 1);
+	arena.deallocate(big, TaskArena::MAX_BLOCK_SIZE + 1);
+	CHECK(arena.getAllocatedBytes() == 0);
+	CHECK(arena.getCachedBytes() == 128 + 2 * 64);
+}
+
+TEST_CASE(task_arena_concurrent)
+{
+	auto arena = std::make_shared<TaskArena>();
+	std::mt19937_64 rng(testSeed());
+	std::atomic_bool intact(true);
+
+	// 多个线程随机大小分配、写满、检查、释放
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++) {
+		uint64_t seed = rng();
+		threads.emplace_back([&, t, seed]() {
+			std::mt19937_64 local(seed);
+			ArenaAllocator<unsigned char> alloc(arena);
+			std::vector<std::pair<unsigned char*, size_t>> live;
+			for (int i = 0; i < 20000 * testIterations(); i++) {
+				if (live.size() < 16 && local() % 2 == 0) {
+					size_t n = 1 + local() % 6000;
+					unsigned char* p = alloc.allocate(n);
+					std::fill(p, p + n, (unsigned char)t);
+					live.emplace_back(p, n);
+				}
+				else if (!live.empty()) {
+					auto block = live.back();
+					live.pop_back();
+					if (std::count(block.first, block.first + block.second, (unsigned char)t) != (long)block.second) {
+						intact = false;
+					}
+					alloc.deallocate(block.first, block.second);
+				}
+			}
+			for (auto& block : live) {
+				alloc.deallocate(block.first, block.second);
+			}
+			});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+
+	CHECK(intact);
+	CHECK(arena->getAllocatedBytes() == 0);
+}
@@ -0,0 +1,155 @@
+﻿// 工作线程上下文测试：当前线程编号/线程池、WorkerLocal每线程一份、ScratchArena每个任务后复位
+#include "test_harness.h"
+
+#include "worker_local.h"
+
+#include <set>
+#include <numeric>
+
+TEST_CASE(worker_context_identifies_worker)
+{
+	CHECK(ThreadPool::currentPool() == nullptr);
+	CHECK(ThreadPool::currentWorkerIndex() == -1);
+	CHECK(ThreadPool::currentScratch() == nullptr);
+
+	ThreadPool pool;
+	pool.start(4);
+
+	std::vector<std::future<int>> results;
+	for (int i = 0; i < 200; i++) {
+		results.emplace_back(pool.submitTask([&pool]() {
+			if (ThreadPool::currentPool() != &pool || ThreadPool::currentScratch() == nullptr) {
+				return -1;
+			}
+			return ThreadPool::currentWorkerIndex();
+			}));
+	}
+	std::set<int> indexes;
+	for (auto& res : results) {
+		int index = res.get();
+		CHECK(index >= 0 && index < pool.getWorkerCapacity());
+		indexes.insert(index);
+	}
+	CHECK(indexes.size() <= 4);
+
+	// 其他类型的线程池的工作线程上查询不到
+	BasicThreadPool<DequeQueuePolicy, NotifyOneWakeup> other;
+	other.start(1);
+	CHECK(other.submitTask([]() { return ThreadPool::currentWorkerIndex(); }).get() == -1);
+}
+
+TEST_CASE(worker_local_per_thread)
+{
+	std::mt19937_64 rng(testSeed());
+	ThreadPool pool;
+	pool.setMode(MODE_CACHED);
+	pool.setTaskQueSizeThreshHold(8);
+	pool.start(4);
+
+	// 每个线程各自累加，不加锁，最后合并
+	std::atomic_int inits(0);
+	WorkerLocal<long long> sums(pool, [&]() { inits++; return 0LL; });
+	WorkerLocal<std::thread::id> owners(pool, []() { return std::this_thread::get_id(); });
+	std::atomic_bool ownerOk(true);
+
+	std::vector<int> values(20000 * testIterations());
+	for (auto& v : values) {
+		v = (int)(rng() % 1000);
+	}
+
+	std::vector<std::future<void>> results;
+	for (int v : values) {
+		results.emplace_back(pool.submitTask([&, v]() {
+			sums.local() += v;
+			if (owners.local() != std::this_thread::get_id()) {
+				ownerOk = false;
+			}
+			}));
+	}
+	for (auto& res : results) {
+		res.get();
+	}
+
+	// 提交线程不是工作线程 有自己的一份
+	sums.local() += 5;
+
+	long long total = 0;
+	int count = 0;
+	sums.forEach([&](long long s) { total += s; count++; });
+	CHECK(total == std::accumulate(values.begin(), values.end(), 0LL) + 5);
+	CHECK(count == inits);
+	CHECK(count <= 8 + 1);
+	CHECK(ownerOk);
+
+	sums.clear();
+	count = 0;
+	sums.forEach([&](long long) { count++; });
+	CHECK(count == 0);
+}
+
+TEST_CASE(scratch_arena_bump_and_reset)
+{
+	ScratchArena arena(1024);
+	CHECK(arena.getCapacityBytes() == 0);
+
+	// 按要求对齐
+	char* a = static_cast<char*>(arena.allocate(3, 1));
+	void* b = arena.allocate(8, 64);
+	CHECK(reinterpret_cast<uintptr_t>(b) % 64 == 0);
+	CHECK(arena.getUsedBytes() == 11);
+	CHECK(arena.getCapacityBytes() == 1024);
+
+	// 超过块大小的请求单独分配，复位时释放
+	void* big = arena.allocate(5000);
+	CHECK(big != nullptr);
+	CHECK(arena.getCapacityBytes() == 1024 + 5000 + alignof(std::max_align_t));
+	arena.reset();
+	CHECK(arena.getUsedBytes() == 0);
+	CHECK(arena.getCapacityBytes() == 1024);
+
+	// 复位后从头复用同一块内存
+	CHECK(arena.allocate(3, 1) == a);
+
+	// 写满一块后换到新块
+	for (int i = 0; i < 100; i++) {
+		std::fill_n(static_cast<char*>(arena.allocate(100)), 100, (char)i);
+	}
+	CHECK(arena.getCapacityBytes() >= 100 * 100);
+	size_t capacity = arena.getCapacityBytes();
+	arena.reset();
+	for (int i = 0; i < 100; i++) {
+		arena.allocate(100);
+	}
+	CHECK(arena.getCapacityBytes() == capacity);
+}
+
+TEST_CASE(scratch_reset_between_tasks)
+{
+	ThreadPool pool;
+	pool.start(1);
+
+	// 同一个工作线程上 每个任务开始时临时内存都是空的，并且复用同一块内存
+	std::vector<std::future<uintptr_t>> results;
+	for (int i = 0; i < 100; i++) {
+		results.emplace_back(pool.submitTask([i]() -> uintptr_t {
+			ScratchArena* scratch = ThreadPool::currentScratch();
+			if (scratch->getUsedBytes() != 0) {
+				return 0;
+			}
+			std::vector<int, ScratchAllocator<int>> v{ ScratchAllocator<int>(*scratch) };
+			v.reserve(1000);
+			for (int k = 0; k < 1000; k++) {
+				v.push_back(i + k);
+			}
+			if (std::accumulate(v.begin(), v.end(), 0LL) != 1000LL * i + 999 * 1000 / 2) {
+				return 0;
+			}
+			return reinterpret_cast<uintptr_t>(v.data());
+			}));
+	}
+	uintptr_t first = results[0].get();
+	CHECK(first != 0);
+	for (size_t i = 1; i < results.size(); i++) {
+		CHECK(results[i].get() == first);
+	}
+}
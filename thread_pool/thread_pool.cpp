@@ -8,12 +8,13 @@ const int THREAD_MAX_IDLE_TIME = 60; // 单位：秒
 ///////////线程池方法实现
 ThreadPool::ThreadPool()
 	: initThreadSize_(0)
+	, threadSizeThreshHold_(THREAD_MAX_THRESHHOLD)
+	, curThreadSize_(0)
 	, taskSize_(0)
-	, idleThreadSize_(0)
-	, isPoolRunning_(false)
 	, taskQueMaxThreshHold_(TASK_MAX_THRESHHOLD)
-	, threadSizeThreshHold_(THREAD_MAX_THRESHHOLD)
+	, idleThreadSize_(0)
 	, poolMode_(PoolMode::MODE_FIXED)
+	, isPoolRunning_(false)
 {
 }
 
@@ -97,20 +98,24 @@ void ThreadPool::start(int initThreadSize = 4) //默认4个线程执行任务
 	// 设置线程池运行状态
 	isPoolRunning_ = true;
 
-	// 创建线程对象
-	for (int i = 0; i < initThreadSize_; i++) {
+	// 线程启动后会修改threads_，创建期间持有锁
+	std::unique_lock<std::mutex> lock(taskQueMtx_);
+
+	// 创建线程对象 线程编号是全局递增的，不一定从0开始，记下本次创建的编号
+	std::vector<int> threadIds;
+	for (int i = 0; i < initThreadSize; i++) {
 		auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, this, std::placeholders::_1));
 		//auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, std::placeholders::_1, this));
 
 		int threadId = ptr->getId();
 		threads_.emplace(threadId, std::move(ptr));
-
+		threadIds.push_back(threadId);
 	}
 
 	// 启动所有线程来工作
-	for (int i = 0; i < initThreadSize_; i++)
+	for (int threadId : threadIds)
 	{
-		threads_[i]->start(); // 启动一个线程
+		threads_[threadId]->start(); // 启动一个线程
 		idleThreadSize_++; // 记录空闲线程数量
 	}
 }
@@ -155,6 +160,7 @@ void ThreadPool::threadFunc(int threadId)
 							idleThreadSize_--;
 
 							std::cout << "thread_id " << std::this_thread::get_id() << "exit!" << std::endl;
+							exitCond_.notify_all(); // 析构函数可能正在等待线程全部退出
 							return;
 						}
 					}
@@ -199,7 +205,7 @@ bool ThreadPool::checkRunnigState() const
 }
 
 ///////////////// 线程方法实现
-size_t Thread::generateNo_ = 0;
+std::atomic_int Thread::generateNo_(0);
 
 Thread::Thread(ThreadFunc func)
 	: func_(func)
@@ -237,31 +243,38 @@ void Task::exec()
 	}
 }
 
-void Task::setResultThis(Result* res)
+void Task::setResultState(std::shared_ptr<ResultState> state)
 {
-	result_ = res;
+	result_ = std::move(state);
 }
 
 ////////////////////////  Result类方法实现
 Result::Result(std::shared_ptr<Task> task, bool isValid)
-	: isValid_(isValid)
+	: state_(std::make_shared<ResultState>())
 	, task_(task)
+	, isValid_(isValid)
+{
+	task_->setResultState(state_);
+}
+
+Any Result::get() // 给用户调用 获取返回值
 {
-	task_->setResultThis(this);
+	if (!isValid_) {
+		return "";
+	}
+	return state_->get();
 }
 
+////////////////////////  ResultState类方法实现
 // 设置返回值
-void Result::setAnyVal(Any any)
+void ResultState::setAnyVal(Any any)
 {
 	this->any_ = std::move(any); //保存task的返回值
 	sem_.post(); // 获取到任务返回值，增加信号量资源
 }
 
-Any Result::get() // 给用户调用 获取返回值
+Any ResultState::get()
 {
-	if (!isValid_) {
-		return "";
-	}
 	sem_.wait(); //等待信号，让线程中的任务执行完再获取返回值
 	return std::move(any_);
 }
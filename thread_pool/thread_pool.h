@@ -1,3 +1,5 @@
+#pragma once
+
 #include <memory>
 #include <vector>
 #include <iostream>
@@ -5,6 +7,10 @@
 #include <queue>
 #include <mutex>
 #include <unordered_map>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <climits>
 
 enum PoolMode {
 	MODE_FIXED,
@@ -88,6 +94,21 @@ private:
 
 class Task;
 
+// ResultTaskķֵ״̬
+// Resultִ֮ǰͱûֱֵдResult߶״̬
+class ResultState {
+public:
+	ResultState() = default;
+	~ResultState() = default;
+
+	void setAnyVal(Any any); //taskķֵ
+	Any get(); //ȴȡֵ
+
+private:
+	Any any_;  // 洢ķֵ
+	Semaphore sem_; // ߳ͨź
+};
+
 // task񷵻ֵResult
 class Result {
 public:
@@ -95,11 +116,9 @@ public:
 	~Result() = default;
 
 	Any get(); //û ȡֵ
-	void setAnyVal(Any any); //taskķֵ
 
 private:
-	Any any_;  // 洢ķֵ
-	Semaphore sem_; // ߳ͨź
+	std::shared_ptr<ResultState> state_; // ķֵ״̬
 	std::shared_ptr<Task> task_; // ָӦȡֵ
 	std::atomic_bool isValid_; // ֵǷЧ
 };
@@ -111,11 +130,11 @@ public:
 	~Task() = default;
 
 	void exec();
-	void setResultThis(Result* res);
+	void setResultState(std::shared_ptr<ResultState> state);
 	virtual Any run() = 0;
 
 private:
-	Result* result_; // Result > Task
+	std::shared_ptr<ResultState> result_; // ResultResultҲ
 };
 
 class Thread {
@@ -134,8 +153,8 @@ public:
 	int getId() const;
 private:
 	ThreadFunc func_;
-	static size_t generateNo_; // ɵ̱߳
-	size_t threadNo_; //̱߳
+	static std::atomic_int generateNo_; // ɵ̱߳ ̳߳ؿͬʱ߳
+	int threadNo_; //̱߳
 };
 
 class ThreadPool {
@@ -170,14 +189,14 @@ private:
 private:
 	std::unordered_map<int, std::unique_ptr<Thread>> threads_; // ߳б
 
-	int initThreadSize_; //ʼ߳
-	int threadSizeThreshHold_; //ֵ߳
+	std::atomic_int initThreadSize_; //ʼ߳ ߳жǷʱȡ
+	std::atomic_int threadSizeThreshHold_; //ֵ߳
 	std::atomic_int curThreadSize_; //¼ǰ̵̳߳߳
 
 	
 	std::queue<std::shared_ptr<Task>> taskQue_; //
 	std::atomic_int taskSize_; //
-	int taskQueMaxThreshHold_; //ֵ
+	std::atomic_int taskQueMaxThreshHold_; //ֵ
 	std::atomic_int idleThreadSize_; // ¼̵߳
 
 	std::mutex taskQueMtx_; //֤е̰߳ȫ
@@ -185,6 +204,6 @@ private:
 	std::condition_variable notEmpty_; //ʾв
 	std::condition_variable exitCond_; //ȵ߳Դȫ
 
-	PoolMode poolMode_; //ǰ̳߳صĹģʽ
+	std::atomic<PoolMode> poolMode_; //ǰ̳߳صĹģʽ ߳ʱҲȡ
 	std::atomic_bool isPoolRunning_; //ʾǰ̳߳״̬
 };
\ No newline at end of file
@@ -0,0 +1,133 @@
+﻿#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// 有界无锁多生产者多消费者队列(Vyukov算法)
+// 每个格子带一个序号，生产者和消费者各自用CAS推进位置，格子序号决定该格子能否写入/读取
+// 容量向上取整为2的幂，满了tryPush返回false，空了tryPop返回false，从不阻塞
+// 有其他线程的入队/出队正在进行时，tryPush/tryPop可能返回false，调用者应当把false当作"暂时没有"
+
+// 调度点 测试在包含本头文件之前定义它，在原子操作之间切换线程来穷举交错执行(见tests/deterministic_scheduler.h)
+#ifndef THREAD_POOL_SCHED_POINT
+#define THREAD_POOL_SCHED_POINT() ((void)0)
+#endif
+
+template<typename T>
+class BoundedQueue {
+public:
+	explicit BoundedQueue(size_t capacity)
+		: mask_(roundUp(capacity) - 1)
+		, cells_(new Cell[mask_ + 1])
+		, enqueuePos_(0)
+		, dequeuePos_(0)
+	{
+		for (size_t i = 0; i <= mask_; i++) {
+			cells_[i].seq.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	//入队 队列满了返回false，只有成功时才会移走value
+	template<typename U>
+	bool tryPush(U&& value)
+	{
+		Cell* cell;
+		size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+		for (;;) {
+			cell = &cells_[pos & mask_];
+			THREAD_POOL_SCHED_POINT();
+			size_t seq = cell->seq.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+			THREAD_POOL_SCHED_POINT();
+			if (diff == 0) {
+				// 格子空闲 尝试占住这个位置
+				if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (diff < 0) {
+				return false; // 队列满
+			}
+			else {
+				pos = enqueuePos_.load(std::memory_order_relaxed);
+			}
+		}
+
+		THREAD_POOL_SCHED_POINT();
+		cell->data = std::forward<U>(value);
+		cell->seq.store(pos + 1, std::memory_order_release); // 发布数据 消费者可以读取了
+		return true;
+	}
+
+	//出队 队列空了返回false
+	bool tryPop(T& value)
+	{
+		Cell* cell;
+		size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+		for (;;) {
+			cell = &cells_[pos & mask_];
+			THREAD_POOL_SCHED_POINT();
+			size_t seq = cell->seq.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+			THREAD_POOL_SCHED_POINT();
+			if (diff == 0) {
+				if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (diff < 0) {
+				return false; // 队列空
+			}
+			else {
+				pos = dequeuePos_.load(std::memory_order_relaxed);
+			}
+		}
+
+		THREAD_POOL_SCHED_POINT();
+		value = std::move(cell->data);
+		cell->data = T();
+		cell->seq.store(pos + mask_ + 1, std::memory_order_release); // 格子进入下一轮 生产者可以写入了
+		return true;
+	}
+
+	//近似判断队列是否为空 并发修改时结果只是一个快照
+	bool empty() const
+	{
+		return enqueuePos_.load() == dequeuePos_.load();
+	}
+
+	//队列容量
+	size_t capacity() const
+	{
+		return mask_ + 1;
+	}
+
+private:
+	static size_t roundUp(size_t n)
+	{
+		size_t cap = 2;
+		while (cap < n) {
+			cap <<= 1;
+		}
+		return cap;
+	}
+
+private:
+	struct Cell {
+		std::atomic<size_t> seq;
+		T data;
+	};
+
+	const size_t mask_;
+	std::unique_ptr<Cell[]> cells_;
+
+	// 生产者和消费者的位置分别独占缓存行
+	alignas(64) std::atomic<size_t> enqueuePos_;
+	alignas(64) std::atomic<size_t> dequeuePos_;
+};
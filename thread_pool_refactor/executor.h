@@ -0,0 +1,334 @@
+﻿#pragma once
+
+#include <memory>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+#include <future>
+#include <cstdint>
+#include <climits>
+
+#include "thread_pool_refactor.h"
+
+// 多个逻辑执行器共享同一个ThreadPool的物理线程
+// 每个Executor拥有独立的任务队列、并发上限和调度权重
+// ExecutorArena只向线程池投递"调度令牌"，令牌在工作线程上运行时才按加权公平(stride调度)挑选要执行的Executor任务
+// 令牌从投递到它挑中的任务执行完都算数，同时占用的工作线程不会超过parallelism
+// 线程池队列满了放不下的令牌由投递者自己执行，不会丢失
+// 这样各子系统互相隔离，又不会因为每个子系统各开一个线程池导致CPU超额订阅
+
+const uint64_t EXECUTOR_STRIDE_BASE = 1 << 20; // stride调度的基准步长
+
+class ExecutorArena;
+
+// 逻辑执行器
+class Executor {
+public:
+	Executor(const Executor&) = delete;
+	Executor& operator=(const Executor&) = delete;
+
+	//给执行器提交任务
+	template<typename Func, typename... Args>
+	auto submitTask(Func&& func, Args&&... args) -> std::future<decltype(func(args...))>;
+
+	//尝试提交任务 执行器的队列没有上限，总是成功，返回的future一定有效
+	//接口与ThreadPool::trySubmitTask一致，Strand等组件可以直接建立在Executor之上
+	template<typename Func, typename... Args>
+	auto trySubmitTask(Func&& func, Args&&... args) -> std::future<decltype(func(args...))>;
+
+	//设置调度权重 权重越大分到的执行机会越多
+	void setWeight(int weight);
+
+	//设置该执行器最多同时占用的工作线程数
+	void setMaxConcurrency(int maxConcurrency);
+
+	//当前排队的任务数量
+	size_t pendingTaskSize() const;
+
+	//当前正在执行的任务数量
+	int runningTaskSize() const;
+
+private:
+	friend class ExecutorArena;
+
+	Executor(ExecutorArena& arena, int weight, int maxConcurrency);
+
+	//是否有任务并且没有超过并发上限
+	bool isRunnable() const;
+
+private:
+	using Task = std::function<void()>;
+
+	ExecutorArena& arena_;
+	std::queue<Task> taskQue_; //执行器自己的任务队列 由arena_的锁保护
+	int weight_; //调度权重
+	int maxConcurrency_; //并发上限
+	int running_; //正在执行的任务数量
+	uint64_t pass_; //stride调度的虚拟时间 越小越优先
+};
+
+// 执行器集合 负责在多个Executor之间做加权公平调度
+class ExecutorArena {
+public:
+	// parallelism: 同时投递到线程池的令牌上限 一般等于线程池的线程数量
+	ExecutorArena(ThreadPool& pool, int parallelism);
+	~ExecutorArena();
+
+	ExecutorArena(const ExecutorArena&) = delete;
+	ExecutorArena& operator=(const ExecutorArena&) = delete;
+
+	//创建一个逻辑执行器 生命周期由arena管理
+	Executor& createExecutor(int weight = 1, int maxConcurrency = INT_MAX);
+
+private:
+	friend class Executor;
+
+	//令牌函数 在线程池的工作线程上挑选并执行一个任务
+	void runOne();
+
+	//挑选pass_最小的可运行执行器 需要持有mtx_
+	Executor* pickLocked();
+
+	//计算还需要投递多少个令牌并预先计数 需要持有mtx_
+	int reserveTokensLocked();
+
+	//向线程池投递令牌 返回线程池放不下的令牌数量 不能持有mtx_
+	int postTokens(int count);
+
+	//投递令牌 放不下的在当前线程执行 不能持有mtx_
+	void dispatchTokens(int count);
+
+	//执行器由空闲变为活跃时 不允许它用积攒的虚拟时间抢占其他执行器 需要持有mtx_
+	void activateLocked(Executor& ex);
+
+private:
+	ThreadPool& pool_;
+	int parallelism_; //令牌上限
+
+	std::vector<std::unique_ptr<Executor>> executors_; //执行器列表
+	int tokens_; //已投递但还没运行结束的令牌数量 包括正在执行任务的令牌
+	uint64_t globalPass_; //最近一次被调度的虚拟时间
+
+	mutable std::mutex mtx_; //保护所有执行器的队列和调度状态
+	std::condition_variable idleCond_; //等待所有任务执行完成
+};
+
+
+///////////执行器方法实现
+inline Executor::Executor(ExecutorArena& arena, int weight, int maxConcurrency)
+	: arena_(arena)
+	, weight_(weight > 0 ? weight : 1)
+	, maxConcurrency_(maxConcurrency > 0 ? maxConcurrency : 1)
+	, running_(0)
+	, pass_(0)
+{
+}
+
+template<typename Func, typename... Args>
+auto Executor::submitTask(Func&& func, Args&&... args) -> std::future<decltype(func(args...))>
+{
+	using Rtype = decltype(func(args...));
+	auto task = std::make_shared<std::packaged_task<Rtype()>>(
+		std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
+
+	std::future<Rtype> result = task->get_future();
+
+	int count = 0;
+	{
+		std::unique_lock<std::mutex> lock(arena_.mtx_);
+		if (taskQue_.empty() && running_ == 0) {
+			arena_.activateLocked(*this);
+		}
+		taskQue_.emplace([task]() {(*task)(); });
+		count = arena_.reserveTokensLocked();
+	}
+	arena_.dispatchTokens(count);
+
+	return result;
+}
+
+template<typename Func, typename... Args>
+auto Executor::trySubmitTask(Func&& func, Args&&... args) -> std::future<decltype(func(args...))>
+{
+	return submitTask(std::forward<Func>(func), std::forward<Args>(args)...);
+}
+
+inline void Executor::setWeight(int weight)
+{
+	std::unique_lock<std::mutex> lock(arena_.mtx_);
+	weight_ = weight > 0 ? weight : 1;
+}
+
+inline void Executor::setMaxConcurrency(int maxConcurrency)
+{
+	int count = 0;
+	{
+		std::unique_lock<std::mutex> lock(arena_.mtx_);
+		maxConcurrency_ = maxConcurrency > 0 ? maxConcurrency : 1;
+		count = arena_.reserveTokensLocked();
+	}
+	// 放宽上限后可能有新的任务可以执行
+	arena_.dispatchTokens(count);
+}
+
+inline size_t Executor::pendingTaskSize() const
+{
+	std::unique_lock<std::mutex> lock(arena_.mtx_);
+	return taskQue_.size();
+}
+
+inline int Executor::runningTaskSize() const
+{
+	std::unique_lock<std::mutex> lock(arena_.mtx_);
+	return running_;
+}
+
+inline bool Executor::isRunnable() const
+{
+	return !taskQue_.empty() && running_ < maxConcurrency_;
+}
+
+
+///////////执行器集合方法实现
+inline ExecutorArena::ExecutorArena(ThreadPool& pool, int parallelism)
+	: pool_(pool)
+	, parallelism_(parallelism > 0 ? parallelism : 1)
+	, tokens_(0)
+	, globalPass_(0)
+{
+}
+
+inline ExecutorArena::~ExecutorArena()
+{
+	// 等待已提交的任务全部执行完，令牌里引用了this
+	std::unique_lock<std::mutex> lock(mtx_);
+	idleCond_.wait(lock, [&]()->bool {
+		if (tokens_ > 0) {
+			return false;
+		}
+		for (auto& ex : executors_) {
+			if (!ex->taskQue_.empty() || ex->running_ > 0) {
+				return false;
+			}
+		}
+		return true;
+		});
+}
+
+inline Executor& ExecutorArena::createExecutor(int weight, int maxConcurrency)
+{
+	std::unique_lock<std::mutex> lock(mtx_);
+	executors_.emplace_back(new Executor(*this, weight, maxConcurrency));
+	return *executors_.back();
+}
+
+inline void ExecutorArena::activateLocked(Executor& ex)
+{
+	if (ex.pass_ < globalPass_) {
+		ex.pass_ = globalPass_;
+	}
+}
+
+inline Executor* ExecutorArena::pickLocked()
+{
+	Executor* best = nullptr;
+	for (auto& ex : executors_) {
+		if (ex->isRunnable() && (best == nullptr || ex->pass_ < best->pass_)) {
+			best = ex.get();
+		}
+	}
+	return best;
+}
+
+inline int ExecutorArena::reserveTokensLocked()
+{
+	// 可以立刻执行的任务数量 = 每个执行器 min(排队数, 剩余并发额度) 之和
+	long long runnable = 0;
+	long long running = 0;
+	for (auto& ex : executors_) {
+		long long quota = ex->maxConcurrency_ - ex->running_;
+		long long queued = (long long)ex->taskQue_.size();
+		if (quota > 0) {
+			runnable += queued < quota ? queued : quota;
+		}
+		running += ex->running_;
+	}
+
+	// 还没挑到任务的令牌会取走一部分可执行任务，正在执行任务的令牌仍然占着并发额度
+	long long idle = tokens_ - running;
+	long long want = runnable - idle;
+	long long room = parallelism_ - tokens_;
+	long long count = want < room ? want : room;
+	if (count <= 0) {
+		return 0;
+	}
+	tokens_ += (int)count;
+	return (int)count;
+}
+
+inline int ExecutorArena::postTokens(int count)
+{
+	int rejected = 0;
+	for (int i = 0; i < count; i++) {
+		std::future<void> res = pool_.trySubmitTask([this]() { runOne(); });
+		if (!res.valid()) {
+			rejected++;
+		}
+	}
+	return rejected;
+}
+
+inline void ExecutorArena::dispatchTokens(int count)
+{
+	int rejected = count > 0 ? postTokens(count) : 0;
+	for (int i = 0; i < rejected; i++) {
+		runOne();
+	}
+}
+
+inline void ExecutorArena::runOne()
+{
+	// 执行完任务后需要补投的令牌如果被线程池拒绝，就在这里接着执行，不递归
+	int owned = 1;
+	while (owned > 0) {
+		owned--;
+
+		Executor* ex = nullptr;
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mtx_);
+			ex = pickLocked();
+			if (ex == nullptr) {
+				// 其他令牌已经把任务取走了
+				tokens_--;
+				idleCond_.notify_all();
+				continue;
+			}
+
+			task = std::move(ex->taskQue_.front());
+			ex->taskQue_.pop();
+			ex->running_++;
+
+			// 权重越大 虚拟时间前进得越慢 下次越容易被选中
+			globalPass_ = ex->pass_;
+			ex->pass_ += EXECUTOR_STRIDE_BASE / (uint64_t)ex->weight_;
+		}
+
+		task();
+
+		int count = 0;
+		{
+			std::unique_lock<std::mutex> lock(mtx_);
+			ex->running_--;
+			tokens_--;
+			count = reserveTokensLocked();
+			idleCond_.notify_all();
+		}
+		// count为0时arena可能已经析构，不能再访问this
+		if (count > 0) {
+			owned += postTokens(count);
+		}
+	}
+}
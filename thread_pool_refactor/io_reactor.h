@@ -0,0 +1,817 @@
+﻿#pragma once
+
+#include <memory>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <system_error>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define THREAD_POOL_HAS_IO_URING 1
+#endif
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define THREAD_POOL_HAS_COROUTINE 1
+#endif
+
+#include "thread_pool_refactor.h"
+
+// 异步I/O反应器(仅Linux)
+// 一个专用的I/O线程等待内核完成事件，完成后把回调投递到ThreadPool的工作线程上执行
+// 工作线程不再阻塞在read/write/accept上，少量线程就能同时挂起大量I/O
+// 后端优先使用io_uring(直接系统调用，不依赖liburing)，内核不支持时退回epoll
+// epoll后端对普通文件无效，普通文件的读写直接在线程池上同步执行
+// epoll后端的系统调用都不在锁内：非阻塞fd和socket读写在I/O线程上执行，
+// 没有设置O_NONBLOCK的管道等fd以及accept在就绪后放到线程池上执行，一次只执行一个，反应器析构时要等这些调用返回
+//
+// 线程池队列满、回调投递不进去时，回调直接在I/O线程(或提交操作的线程)上执行
+// 所有操作的结果: >= 0 表示传输的字节数(accept为新连接的fd)，< 0 表示 -errno
+// 缓冲区在操作完成前必须保持有效；反应器析构时未完成的操作以 -ECANCELED 结束
+// 线程池的生命周期必须长于反应器；io_uring和epoll都建立不起来时构造函数抛出std::system_error
+
+enum IoBackend {
+	IO_BACKEND_AUTO, //能用io_uring就用io_uring
+	IO_BACKEND_IO_URING,
+	IO_BACKEND_EPOLL,
+};
+
+enum IoOpType {
+	IO_OP_READ,
+	IO_OP_WRITE,
+	IO_OP_ACCEPT,
+};
+
+const unsigned IO_URING_ENTRIES = 4096; // io_uring提交队列大小 完成队列是它的两倍
+
+class IoReactor {
+public:
+	using IoCallback = std::function<void(ssize_t)>;
+
+	explicit IoReactor(ThreadPool& pool, IoBackend backend = IO_BACKEND_AUTO);
+	~IoReactor();
+
+	IoReactor(const IoReactor&) = delete;
+	IoReactor& operator=(const IoReactor&) = delete;
+
+	//回调版本 回调在线程池的工作线程上执行
+	//offset为-1时使用文件当前位置，管道和socket必须传-1
+	void asyncRead(int fd, void* buf, size_t len, off_t offset, IoCallback callback);
+	void asyncWrite(int fd, const void* buf, size_t len, off_t offset, IoCallback callback);
+	void asyncAccept(int fd, IoCallback callback);
+
+	//future版本
+	std::future<ssize_t> asyncRead(int fd, void* buf, size_t len, off_t offset = -1);
+	std::future<ssize_t> asyncWrite(int fd, const void* buf, size_t len, off_t offset = -1);
+	std::future<ssize_t> asyncAccept(int fd);
+
+#ifdef THREAD_POOL_HAS_COROUTINE
+	// 协程版本 co_await 返回操作结果，协程在线程池的工作线程上恢复执行
+	class Awaitable {
+	public:
+		Awaitable(IoReactor& reactor, IoOpType type, int fd, void* buf, size_t len, off_t offset)
+			: reactor_(reactor), type_(type), fd_(fd), buf_(buf), len_(len), offset_(offset), result_(0)
+		{}
+
+		bool await_ready() const noexcept { return false; }
+
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			reactor_.submit(type_, fd_, buf_, len_, offset_, [this, handle](ssize_t res) {
+				result_ = res;
+				handle.resume();
+				});
+		}
+
+		ssize_t await_resume() const noexcept { return result_; }
+
+	private:
+		IoReactor& reactor_;
+		IoOpType type_;
+		int fd_;
+		void* buf_;
+		size_t len_;
+		off_t offset_;
+		ssize_t result_;
+	};
+
+	Awaitable awaitRead(int fd, void* buf, size_t len, off_t offset = -1) { return Awaitable(*this, IO_OP_READ, fd, buf, len, offset); }
+	Awaitable awaitWrite(int fd, const void* buf, size_t len, off_t offset = -1) { return Awaitable(*this, IO_OP_WRITE, fd, const_cast<void*>(buf), len, offset); }
+	Awaitable awaitAccept(int fd) { return Awaitable(*this, IO_OP_ACCEPT, fd, nullptr, 0, -1); }
+#endif
+
+	//实际使用的后端
+	IoBackend getBackend() const;
+
+private:
+	// 一次I/O操作
+	struct IoOp {
+		IoOpType type;
+		int fd;
+		void* buf;
+		size_t len;
+		off_t offset;
+		IoCallback callback;
+	};
+
+	// 后端接口
+	class Backend {
+	public:
+		virtual ~Backend() = default;
+		virtual void submit(IoOp* op) = 0;
+	};
+
+#ifdef THREAD_POOL_HAS_IO_URING
+	class UringBackend;
+#endif
+	class EpollBackend;
+
+	//提交操作
+	void submit(IoOpType type, int fd, void* buf, size_t len, off_t offset, IoCallback callback);
+
+	//在线程池上执行回调并释放操作 线程池拒绝时在当前线程上执行
+	void complete(IoOp* op, ssize_t result);
+
+	//同步执行操作(epoll后端处理普通文件、以及epoll就绪后的调用)
+	static ssize_t perform(IoOp* op, int extraFlags);
+
+private:
+	ThreadPool& pool_;
+	IoBackend backend_;
+	std::unique_ptr<Backend> impl_;
+};
+
+
+#ifdef THREAD_POOL_HAS_IO_URING
+///////////io_uring后端
+class IoReactor::UringBackend : public IoReactor::Backend {
+public:
+	// 建立io_uring失败返回nullptr
+	static std::unique_ptr<UringBackend> create(IoReactor& reactor)
+	{
+		std::unique_ptr<UringBackend> backend(new UringBackend(reactor));
+		if (!backend->setup()) {
+			return nullptr;
+		}
+		backend->thread_ = std::thread(&UringBackend::reactorFunc, backend.get());
+		return backend;
+	}
+
+	~UringBackend()
+	{
+		if (thread_.joinable()) {
+			{
+				// 取消所有未完成的操作，并用一个NOP唤醒I/O线程
+				// 提交队列放不下的取消请求由I/O线程收割完成事件后继续发出
+				std::unique_lock<std::mutex> lock(mtx_);
+				stopping_ = true;
+				uncancelled_ = inflight_;
+				cancelLocked();
+				io_uring_sqe* sqe = getSqeLocked();
+				if (sqe != nullptr) {
+					sqe->opcode = IORING_OP_NOP;
+					sqe->fd = -1;
+					sqe->user_data = WAKE_TAG;
+				}
+				flushLocked();
+			}
+			thread_.join();
+		}
+
+		if (sqes_ != nullptr) munmap(sqes_, sqesSize_);
+		if (cqPtr_ != nullptr && cqPtr_ != sqPtr_) munmap(cqPtr_, cqRingSize_);
+		if (sqPtr_ != nullptr) munmap(sqPtr_, sqRingSize_);
+		if (ringFd_ >= 0) close(ringFd_);
+	}
+
+	void submit(IoOp* op) override
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+		io_uring_sqe* sqe = stopping_ ? nullptr : getSqeLocked();
+		if (sqe == nullptr) {
+			lock.unlock();
+			reactor_.complete(op, stopping_ ? -ECANCELED : -EBUSY);
+			return;
+		}
+
+		switch (op->type) {
+		case IO_OP_READ:
+			sqe->opcode = IORING_OP_READ;
+			sqe->addr = (uint64_t)(uintptr_t)op->buf;
+			sqe->len = (uint32_t)op->len;
+			sqe->off = (uint64_t)op->offset;
+			break;
+		case IO_OP_WRITE:
+			sqe->opcode = IORING_OP_WRITE;
+			sqe->addr = (uint64_t)(uintptr_t)op->buf;
+			sqe->len = (uint32_t)op->len;
+			sqe->off = (uint64_t)op->offset;
+			break;
+		case IO_OP_ACCEPT:
+			sqe->opcode = IORING_OP_ACCEPT;
+			sqe->accept_flags = SOCK_CLOEXEC;
+			break;
+		}
+		sqe->fd = op->fd;
+		sqe->user_data = (uint64_t)(uintptr_t)op;
+
+		inflight_.insert(op);
+		flushLocked();
+	}
+
+private:
+	static constexpr uint64_t WAKE_TAG = 1; // 操作指针至少按8字节对齐，不会和这两个标记冲突
+	static constexpr uint64_t CANCEL_TAG = 2;
+
+	explicit UringBackend(IoReactor& reactor)
+		: reactor_(reactor)
+	{}
+
+	bool setup()
+	{
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		ringFd_ = (int)syscall(__NR_io_uring_setup, IO_URING_ENTRIES, &params);
+		if (ringFd_ < 0) {
+			return false;
+		}
+
+		// 需要FAST_POLL(5.7+)：有它时READ/WRITE/ACCEPT都可用，socket也不会占用内核工作线程
+		if (!(params.features & IORING_FEAT_FAST_POLL)) {
+			return false;
+		}
+
+		sqEntries_ = params.sq_entries;
+		sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (singleMmap) {
+			sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+		}
+
+		sqPtr_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+		if (sqPtr_ == MAP_FAILED) {
+			sqPtr_ = nullptr;
+			return false;
+		}
+		if (singleMmap) {
+			cqPtr_ = sqPtr_;
+		}
+		else {
+			cqPtr_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+			if (cqPtr_ == MAP_FAILED) {
+				cqPtr_ = nullptr;
+				return false;
+			}
+		}
+
+		sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+		void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+		if (sqes == MAP_FAILED) {
+			return false;
+		}
+		sqes_ = (io_uring_sqe*)sqes;
+
+		char* sq = (char*)sqPtr_;
+		sqHead_ = (unsigned*)(sq + params.sq_off.head);
+		sqTail_ = (unsigned*)(sq + params.sq_off.tail);
+		sqMask_ = *(unsigned*)(sq + params.sq_off.ring_mask);
+		sqArray_ = (unsigned*)(sq + params.sq_off.array);
+
+		char* cq = (char*)cqPtr_;
+		cqHead_ = (unsigned*)(cq + params.cq_off.head);
+		cqTail_ = (unsigned*)(cq + params.cq_off.tail);
+		cqMask_ = *(unsigned*)(cq + params.cq_off.ring_mask);
+		cqes_ = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+		sqLocalTail_ = *sqTail_;
+		sqSubmitted_ = sqLocalTail_;
+		return true;
+	}
+
+	//取一个空闲的提交项 需要持有mtx_
+	io_uring_sqe* getSqeLocked()
+	{
+		unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+		if (sqLocalTail_ - head >= sqEntries_) {
+			flushLocked();
+			head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+			if (sqLocalTail_ - head >= sqEntries_) {
+				return nullptr;
+			}
+		}
+
+		unsigned index = sqLocalTail_ & sqMask_;
+		io_uring_sqe* sqe = &sqes_[index];
+		memset(sqe, 0, sizeof(*sqe));
+		sqArray_[index] = index;
+		sqLocalTail_++;
+		return sqe;
+	}
+
+	//把已经填好的提交项交给内核 需要持有mtx_
+	void flushLocked()
+	{
+		__atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+		unsigned pending = sqLocalTail_ - sqSubmitted_;
+		if (pending == 0) {
+			return;
+		}
+
+		// 完成队列暂时满了(EBUSY)时提交会失败，留给I/O线程收割完成事件后再提交
+		int ret = (int)syscall(__NR_io_uring_enter, ringFd_, pending, 0, 0, nullptr, 0);
+		if (ret > 0) {
+			sqSubmitted_ += (unsigned)ret;
+		}
+	}
+
+	//为还没有取消的操作发出取消请求，提交队列满时留下剩余的等下次再发 需要持有mtx_
+	void cancelLocked()
+	{
+		for (auto it = uncancelled_.begin(); it != uncancelled_.end();) {
+			io_uring_sqe* sqe = getSqeLocked();
+			if (sqe == nullptr) {
+				break;
+			}
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->fd = -1;
+			sqe->addr = (uint64_t)(uintptr_t)*it;
+			sqe->user_data = CANCEL_TAG;
+			it = uncancelled_.erase(it);
+		}
+		flushLocked();
+	}
+
+	//I/O线程 等待并收割完成事件
+	void reactorFunc()
+	{
+		for (;;) {
+			syscall(__NR_io_uring_enter, ringFd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+
+			unsigned head = *cqHead_;
+			unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+			while (head != tail) {
+				io_uring_cqe* cqe = &cqes_[head & cqMask_];
+				uint64_t tag = cqe->user_data;
+				int res = cqe->res;
+				head++;
+				__atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+
+				if (tag == WAKE_TAG || tag == CANCEL_TAG) {
+					continue;
+				}
+
+				IoOp* op = (IoOp*)(uintptr_t)tag;
+				{
+					std::unique_lock<std::mutex> lock(mtx_);
+					inflight_.erase(op);
+					uncancelled_.erase(op);
+				}
+				reactor_.complete(op, res);
+			}
+
+			std::unique_lock<std::mutex> lock(mtx_);
+			if (stopping_) {
+				cancelLocked();
+			}
+			else {
+				flushLocked();
+			}
+			if (stopping_ && inflight_.empty()) {
+				return;
+			}
+		}
+	}
+
+private:
+	IoReactor& reactor_;
+	int ringFd_ = -1;
+
+	void* sqPtr_ = nullptr;
+	void* cqPtr_ = nullptr;
+	size_t sqRingSize_ = 0;
+	size_t cqRingSize_ = 0;
+	io_uring_sqe* sqes_ = nullptr;
+	size_t sqesSize_ = 0;
+
+	unsigned* sqHead_ = nullptr;
+	unsigned* sqTail_ = nullptr;
+	unsigned* sqArray_ = nullptr;
+	unsigned sqMask_ = 0;
+	unsigned sqEntries_ = 0;
+	unsigned sqLocalTail_ = 0; //已经填好的提交项位置
+	unsigned sqSubmitted_ = 0; //已经交给内核的提交项位置
+
+	unsigned* cqHead_ = nullptr;
+	unsigned* cqTail_ = nullptr;
+	unsigned cqMask_ = 0;
+	io_uring_cqe* cqes_ = nullptr;
+
+	std::mutex mtx_; //保护提交队列和inflight_
+	std::unordered_set<IoOp*> inflight_; //已提交未完成的操作
+	std::unordered_set<IoOp*> uncancelled_; //析构时还没有发出取消请求的操作
+	bool stopping_ = false;
+	std::thread thread_; //I/O线程
+};
+#endif
+
+
+///////////epoll后端
+class IoReactor::EpollBackend : public IoReactor::Backend {
+public:
+	// epoll是最后的后端，建立失败(例如fd耗尽)时抛出std::system_error
+	explicit EpollBackend(IoReactor& reactor)
+		: reactor_(reactor)
+		, epollFd_(epoll_create1(EPOLL_CLOEXEC))
+		, wakeFd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+		, stopping_(false)
+		, running_(0)
+	{
+		epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = wakeFd_;
+		if (epollFd_ < 0 || wakeFd_ < 0 || epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &ev) != 0) {
+			int err = errno;
+			if (wakeFd_ >= 0) close(wakeFd_);
+			if (epollFd_ >= 0) close(epollFd_);
+			throw std::system_error(err, std::system_category(), "IoReactor: epoll setup failed");
+		}
+
+		thread_ = std::thread(&EpollBackend::reactorFunc, this);
+	}
+
+	~EpollBackend()
+	{
+		stopping_ = true;
+		uint64_t one = 1;
+		ssize_t ret = write(wakeFd_, &one, sizeof(one));
+		(void)ret;
+		thread_.join();
+
+		// 等线程池上正在执行的阻塞调用返回，它们结束时还要访问fds_
+		std::unique_lock<std::mutex> lock(mtx_);
+		idleCond_.wait(lock, [&]()->bool { return running_ == 0; });
+		lock.unlock();
+
+		// 未完成的操作全部取消
+		for (auto& item : fds_) {
+			for (IoOp* op : item.second.readers) {
+				reactor_.complete(op, -ECANCELED);
+			}
+			for (IoOp* op : item.second.writers) {
+				reactor_.complete(op, -ECANCELED);
+			}
+		}
+
+		close(wakeFd_);
+		close(epollFd_);
+	}
+
+	void submit(IoOp* op) override
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+		if (stopping_) {
+			lock.unlock();
+			reactor_.complete(op, -ECANCELED);
+			return;
+		}
+
+		auto inserted = fds_.try_emplace(op->fd);
+		FdState& state = inserted.first->second;
+		if (inserted.second) {
+			struct stat st;
+			state.socket = fstat(op->fd, &st) == 0 && S_ISSOCK(st.st_mode);
+			int flags = fcntl(op->fd, F_GETFL);
+			state.nonBlocking = flags >= 0 && (flags & O_NONBLOCK) != 0;
+		}
+		(op->type == IO_OP_WRITE ? state.writers : state.readers).push_back(op);
+
+		if (!updateLocked(op->fd, state)) {
+			// 普通文件不支持epoll，直接在线程池上同步执行
+			(op->type == IO_OP_WRITE ? state.writers : state.readers).pop_back();
+			if (state.readers.empty() && state.writers.empty()) {
+				fds_.erase(op->fd);
+			}
+			lock.unlock();
+
+			IoReactor& reactor = reactor_;
+			std::future<void> res = reactor_.pool_.trySubmitTask([&reactor, op]() {
+				reactor.complete(op, perform(op, 0));
+				});
+			if (!res.valid()) {
+				reactor_.complete(op, perform(op, 0));
+			}
+		}
+	}
+
+private:
+	// 每个fd上排队的操作
+	struct FdState {
+		std::deque<IoOp*> readers; //读和accept
+		std::deque<IoOp*> writers;
+		bool registered = false;
+		bool socket = false; //socket的读写带MSG_DONTWAIT，不会阻塞
+		bool nonBlocking = false; //fd设置了O_NONBLOCK
+		bool readBusy = false; //该方向的操作正在锁外执行，执行完之前不再监听这个方向
+		bool writeBusy = false;
+	};
+
+	//按当前排队的操作更新fd的监听事件 需要持有mtx_
+	bool updateLocked(int fd, FdState& state)
+	{
+		epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLONESHOT;
+		if (!state.readers.empty() && !state.readBusy) ev.events |= EPOLLIN;
+		if (!state.writers.empty() && !state.writeBusy) ev.events |= EPOLLOUT;
+		ev.data.fd = fd;
+
+		// 没有要监听的方向(排队的方向都在执行中)时保持oneshot触发后的停用状态，
+		// 否则EPOLLHUP/EPOLLERR会在执行期间反复唤醒I/O线程
+		if (state.registered && ev.events == EPOLLONESHOT) {
+			return true;
+		}
+		if (state.registered) {
+			return epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+		}
+		if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+			return false;
+		}
+		state.registered = true;
+		return true;
+	}
+
+	//一个方向执行完毕 还有操作就重新监听，都没有了就取消注册，用户拿到结果后可以放心关闭fd 需要持有mtx_
+	void finishLocked(int fd, bool isWrite)
+	{
+		auto it = fds_.find(fd);
+		FdState& state = it->second;
+		(isWrite ? state.writeBusy : state.readBusy) = false;
+		if (state.readers.empty() && state.writers.empty() && !state.readBusy && !state.writeBusy) {
+			epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+			fds_.erase(it);
+		}
+		else {
+			updateLocked(fd, state);
+		}
+	}
+
+	//执行就绪方向上排队的操作 调用前该方向已经标记为执行中，不能持有mtx_
+	//非阻塞的fd和socket读写在I/O线程上一直做到EAGAIN；阻塞的fd做完一次就不知道还有没有数据了，
+	//所以每次就绪只取一个操作交给线程池，执行完再重新监听
+	//回调在更新完fd的监听状态之后才执行，用户拿到结果关闭fd时反应器不会再访问它
+	void runReady(int fd, bool isWrite)
+	{
+		std::vector<std::pair<IoOp*, ssize_t>> done;
+		for (;;) {
+			IoOp* op = nullptr;
+			{
+				std::unique_lock<std::mutex> lock(mtx_);
+				FdState& state = fds_[fd];
+				std::deque<IoOp*>& ops = isWrite ? state.writers : state.readers;
+				if (ops.empty()) {
+					finishLocked(fd, isWrite);
+					break;
+				}
+				op = ops.front();
+				ops.pop_front();
+				if (!state.nonBlocking && !(state.socket && op->type != IO_OP_ACCEPT)) {
+					running_++;
+					lock.unlock();
+					runBlocking(fd, isWrite, op);
+					break;
+				}
+			}
+
+			ssize_t res = perform(op, MSG_DONTWAIT);
+			if (res == -EAGAIN || res == -EWOULDBLOCK) {
+				std::unique_lock<std::mutex> lock(mtx_);
+				FdState& state = fds_[fd];
+				(isWrite ? state.writers : state.readers).push_front(op);
+				finishLocked(fd, isWrite);
+				break;
+			}
+			done.emplace_back(op, res);
+		}
+
+		for (auto& item : done) {
+			reactor_.complete(item.first, item.second);
+		}
+	}
+
+	//在线程池上执行可能阻塞的操作 线程池拒绝时只能在当前线程上执行
+	void runBlocking(int fd, bool isWrite, IoOp* op)
+	{
+		auto job = [this, fd, isWrite, op]() {
+			ssize_t res = perform(op, 0);
+			{
+				std::unique_lock<std::mutex> lock(mtx_);
+				finishLocked(fd, isWrite);
+			}
+			reactor_.complete(op, res);
+
+			// 计数归零后反应器可能马上析构，解锁之后不能再访问this
+			std::unique_lock<std::mutex> lock(mtx_);
+			running_--;
+			idleCond_.notify_all();
+		};
+		if (!reactor_.pool_.trySubmitTask(job).valid()) {
+			job();
+		}
+	}
+
+	//I/O线程
+	void reactorFunc()
+	{
+		const int MAX_EVENTS = 256;
+		epoll_event events[MAX_EVENTS];
+
+		while (!stopping_) {
+			int n = epoll_wait(epollFd_, events, MAX_EVENTS, -1);
+			std::vector<std::pair<int, bool>> ready; //(fd, 是否写方向)
+			{
+				std::unique_lock<std::mutex> lock(mtx_);
+				for (int i = 0; i < n; i++) {
+					int fd = events[i].data.fd;
+					if (fd == wakeFd_) {
+						continue;
+					}
+
+					auto it = fds_.find(fd);
+					if (it == fds_.end()) {
+						continue;
+					}
+					FdState& state = it->second;
+
+					uint32_t mask = events[i].events;
+					if ((mask & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !state.readers.empty() && !state.readBusy) {
+						state.readBusy = true;
+						ready.emplace_back(fd, false);
+					}
+					if ((mask & (EPOLLOUT | EPOLLHUP | EPOLLERR)) && !state.writers.empty() && !state.writeBusy) {
+						state.writeBusy = true;
+						ready.emplace_back(fd, true);
+					}
+
+					// 另一个方向可能还在等待
+					updateLocked(fd, state);
+				}
+			}
+
+			for (auto& item : ready) {
+				runReady(item.first, item.second);
+			}
+		}
+	}
+
+private:
+	IoReactor& reactor_;
+	int epollFd_;
+	int wakeFd_; //析构时唤醒I/O线程
+	std::atomic_bool stopping_;
+
+	std::mutex mtx_; //保护fds_和running_
+	std::unordered_map<int, FdState> fds_;
+	int running_; //线程池上正在执行的阻塞操作数量
+	std::condition_variable idleCond_; //等待线程池上的阻塞操作结束
+	std::thread thread_; //I/O线程
+};
+
+
+///////////反应器方法实现
+inline IoReactor::IoReactor(ThreadPool& pool, IoBackend backend)
+	: pool_(pool)
+	, backend_(IO_BACKEND_EPOLL)
+{
+#ifdef THREAD_POOL_HAS_IO_URING
+	if (backend != IO_BACKEND_EPOLL) {
+		impl_ = UringBackend::create(*this);
+		if (impl_ != nullptr) {
+			backend_ = IO_BACKEND_IO_URING;
+		}
+	}
+#endif
+	if (impl_ == nullptr) {
+		impl_.reset(new EpollBackend(*this));
+	}
+}
+
+inline IoReactor::~IoReactor()
+{
+	// 后端析构时会取消未完成的操作并等待I/O线程退出
+	impl_.reset();
+}
+
+inline IoBackend IoReactor::getBackend() const
+{
+	return backend_;
+}
+
+inline void IoReactor::submit(IoOpType type, int fd, void* buf, size_t len, off_t offset, IoCallback callback)
+{
+	impl_->submit(new IoOp{ type, fd, buf, len, offset, std::move(callback) });
+}
+
+inline void IoReactor::complete(IoOp* op, ssize_t result)
+{
+	std::future<void> res = pool_.trySubmitTask([op, result]() {
+		std::unique_ptr<IoOp> guard(op);
+		op->callback(result);
+		});
+	if (!res.valid()) {
+		// 不能丢掉回调 否则等待结果的future永远不会就绪
+		std::unique_ptr<IoOp> guard(op);
+		op->callback(result);
+	}
+}
+
+inline ssize_t IoReactor::perform(IoOp* op, int extraFlags)
+{
+	ssize_t res = -1;
+	switch (op->type) {
+	case IO_OP_READ:
+		if (op->offset >= 0) {
+			res = pread(op->fd, op->buf, op->len, op->offset);
+			break;
+		}
+		// socket用recv带上MSG_DONTWAIT，即使fd是阻塞模式也不会卡住I/O线程
+		res = extraFlags != 0 ? recv(op->fd, op->buf, op->len, extraFlags) : -1;
+		if (extraFlags == 0 || (res < 0 && errno == ENOTSOCK)) {
+			res = read(op->fd, op->buf, op->len);
+		}
+		break;
+	case IO_OP_WRITE:
+		if (op->offset >= 0) {
+			res = pwrite(op->fd, op->buf, op->len, op->offset);
+			break;
+		}
+		res = extraFlags != 0 ? send(op->fd, op->buf, op->len, extraFlags | MSG_NOSIGNAL) : -1;
+		if (extraFlags == 0 || (res < 0 && errno == ENOTSOCK)) {
+			res = write(op->fd, op->buf, op->len);
+		}
+		break;
+	case IO_OP_ACCEPT:
+		res = accept4(op->fd, nullptr, nullptr, SOCK_CLOEXEC);
+		break;
+	}
+	return res < 0 ? -errno : res;
+}
+
+inline void IoReactor::asyncRead(int fd, void* buf, size_t len, off_t offset, IoCallback callback)
+{
+	submit(IO_OP_READ, fd, buf, len, offset, std::move(callback));
+}
+
+inline void IoReactor::asyncWrite(int fd, const void* buf, size_t len, off_t offset, IoCallback callback)
+{
+	submit(IO_OP_WRITE, fd, const_cast<void*>(buf), len, offset, std::move(callback));
+}
+
+inline void IoReactor::asyncAccept(int fd, IoCallback callback)
+{
+	submit(IO_OP_ACCEPT, fd, nullptr, 0, -1, std::move(callback));
+}
+
+inline std::future<ssize_t> IoReactor::asyncRead(int fd, void* buf, size_t len, off_t offset)
+{
+	auto promise = std::make_shared<std::promise<ssize_t>>();
+	asyncRead(fd, buf, len, offset, [promise](ssize_t res) { promise->set_value(res); });
+	return promise->get_future();
+}
+
+inline std::future<ssize_t> IoReactor::asyncWrite(int fd, const void* buf, size_t len, off_t offset)
+{
+	auto promise = std::make_shared<std::promise<ssize_t>>();
+	asyncWrite(fd, buf, len, offset, [promise](ssize_t res) { promise->set_value(res); });
+	return promise->get_future();
+}
+
+inline std::future<ssize_t> IoReactor::asyncAccept(int fd)
+{
+	auto promise = std::make_shared<std::promise<ssize_t>>();
+	asyncAccept(fd, [promise](ssize_t res) { promise->set_value(res); });
+	return promise->get_future();
+}
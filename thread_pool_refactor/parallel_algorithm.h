@@ -0,0 +1,312 @@
+﻿#pragma once
+
+#include <vector>
+#include <future>
+#include <atomic>
+#include <iterator>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <exception>
+#include <utility>
+#include <cstddef>
+
+#include "thread_pool_refactor.h"
+
+// 基于线程池的STL风格并行算法
+// 所有算法都在调用线程上把数据切成若干块，块交给线程池的工作线程执行，调用线程自己也执行第一块，最后等待所有块完成
+// 线程池队列满了放不下的块由调用线程自己执行，不会因为任务被拒绝而漏掉数据
+// 块大小按缓存大小来定：每块至少填满L1，最多不超过L2的一半，同时保证块数足够让所有线程都有活干
+// 任务内部不会再等待其他任务，可以放心在FIXED模式的小线程池上使用
+
+const size_t PARALLEL_MIN_CHUNK_BYTES = 32 * 1024; // 每块最少的数据量 约等于L1大小
+const size_t PARALLEL_MAX_CHUNK_BYTES = 256 * 1024; // 每块最多的数据量 约等于L2的一半
+const int PARALLEL_CHUNKS_PER_THREAD = 4; // 每个线程平均分到的块数 用于负载均衡
+
+namespace parallel_detail {
+
+	//计算块大小(元素个数)
+	inline size_t chunkSize(int threadSize, size_t n, size_t elemSize)
+	{
+		size_t minChunk = std::max<size_t>(1, PARALLEL_MIN_CHUNK_BYTES / elemSize);
+		size_t maxChunk = std::max<size_t>(minChunk, PARALLEL_MAX_CHUNK_BYTES / elemSize);
+		size_t chunks = (size_t)std::max(1, threadSize) * PARALLEL_CHUNKS_PER_THREAD;
+		size_t chunk = (n + chunks - 1) / chunks;
+		return std::min(std::max(chunk, minChunk), maxChunk);
+	}
+
+	//并行执行func(0) ... func(count - 1)，调用线程执行func(0)以及队列放不下的块，第一个异常会重新抛出
+	template<typename Pool, typename Func>
+	void runChunks(Pool& pool, size_t count, Func&& func)
+	{
+		if (count == 0) {
+			return;
+		}
+
+		std::exception_ptr error;
+		auto runInline = [&](size_t i) {
+			try {
+				func(i);
+			}
+			catch (...) {
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+		};
+
+		std::vector<std::future<void>> results;
+		results.reserve(count - 1);
+		for (size_t i = 1; i < count; i++) {
+			std::future<void> res = pool.trySubmitTask([&func, i]() { func(i); });
+			if (res.valid()) {
+				results.emplace_back(std::move(res));
+			}
+			else {
+				runInline(i);
+			}
+		}
+
+		runInline(0);
+
+		// 即使出错也要等所有块结束，块里引用了调用者栈上的数据
+		for (auto& res : results) {
+			try {
+				res.get();
+			}
+			catch (...) {
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+		}
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	//归并路径划分：在a和b合并后的第k个位置，返回a中参与前k个输出的元素个数
+	template<typename It, typename Compare>
+	size_t coRank(size_t k, It a, size_t m, It b, size_t n, Compare& comp)
+	{
+		// 找满足 b[j - 1] < a[i] 的最小i (j = k - i)，随i增大该条件单调地由假变真
+		// 与std::merge一样，相等时优先取a中的元素
+		size_t lo = k > n ? k - n : 0;
+		size_t hi = std::min(k, m);
+		while (lo < hi) {
+			size_t i = lo + (hi - lo) / 2;
+			if (comp(b[k - i - 1], a[i])) {
+				hi = i;
+			}
+			else {
+				lo = i + 1;
+			}
+		}
+		return lo;
+	}
+
+	//把src中宽度为width的有序段两两归并到dst
+	//每次归并的结果再按chunk切段，用归并路径找出每段在两个输入中的起点，所有段一起并行执行
+	template<typename Pool, typename SrcIt, typename DstIt, typename Compare>
+	void mergeRound(Pool& pool, SrcIt src, DstIt dst, size_t n, size_t width, size_t chunk, Compare& comp)
+	{
+		struct Piece {
+			size_t aBegin, aEnd, bBegin, bEnd, out;
+		};
+
+		std::vector<Piece> pieces;
+		for (size_t lo = 0; lo < n; lo += 2 * width) {
+			size_t mid = std::min(n, lo + width);
+			size_t hi = std::min(n, lo + 2 * width);
+			size_t m = mid - lo;
+			size_t len = hi - lo;
+
+			for (size_t k = 0; k < len; k += chunk) {
+				size_t kEnd = std::min(len, k + chunk);
+				size_t i0 = coRank(k, src + lo, m, src + mid, hi - mid, comp);
+				size_t i1 = coRank(kEnd, src + lo, m, src + mid, hi - mid, comp);
+				pieces.push_back(Piece{ lo + i0, lo + i1, mid + (k - i0), mid + (kEnd - i1), lo + k });
+			}
+		}
+
+		runChunks(pool, pieces.size(), [&](size_t p) {
+			const Piece& pc = pieces[p];
+			std::merge(std::make_move_iterator(src + pc.aBegin), std::make_move_iterator(src + pc.aEnd),
+				std::make_move_iterator(src + pc.bBegin), std::make_move_iterator(src + pc.bEnd),
+				dst + pc.out, comp);
+			});
+	}
+}
+
+//并行执行func(i)，i属于[first, last)
+template<typename Pool, typename Index, typename Func>
+void parallel_for(Pool& pool, Index first, Index last, Func func)
+{
+	if (!(first < last)) {
+		return;
+	}
+	size_t n = (size_t)(last - first);
+	size_t chunk = parallel_detail::chunkSize(pool.getThreadSize(), n, sizeof(Index));
+	size_t count = (n + chunk - 1) / chunk;
+
+	parallel_detail::runChunks(pool, count, [&](size_t c) {
+		Index begin = first + (Index)(c * chunk);
+		Index end = first + (Index)std::min(n, (c + 1) * chunk);
+		for (Index i = begin; i < end; i++) {
+			func(i);
+		}
+		});
+}
+
+//并行版std::transform
+template<typename Pool, typename InputIt, typename OutputIt, typename UnaryOp>
+OutputIt parallel_transform(Pool& pool, InputIt first, InputIt last, OutputIt dFirst, UnaryOp op)
+{
+	using T = typename std::iterator_traits<InputIt>::value_type;
+
+	size_t n = (size_t)std::distance(first, last);
+	size_t chunk = parallel_detail::chunkSize(pool.getThreadSize(), n, sizeof(T));
+	size_t count = (n + chunk - 1) / chunk;
+
+	parallel_detail::runChunks(pool, count, [&](size_t c) {
+		size_t begin = c * chunk;
+		size_t end = std::min(n, begin + chunk);
+		std::transform(first + begin, first + end, dFirst + begin, op);
+		});
+	return dFirst + n;
+}
+
+//并行版std::find_if，返回第一个满足条件的元素
+//找到之后，位于它后面的块会提前退出
+template<typename Pool, typename InputIt, typename UnaryPred>
+InputIt parallel_find_if(Pool& pool, InputIt first, InputIt last, UnaryPred pred)
+{
+	using T = typename std::iterator_traits<InputIt>::value_type;
+
+	size_t n = (size_t)std::distance(first, last);
+	size_t chunk = parallel_detail::chunkSize(pool.getThreadSize(), n, sizeof(T));
+	size_t count = (n + chunk - 1) / chunk;
+	std::atomic<size_t> found(n); //目前找到的最小下标
+
+	// 块内再按小段检查是否已经有更靠前的结果，避免扫完整块
+	const size_t step = std::max<size_t>(1, chunk / 16);
+
+	parallel_detail::runChunks(pool, count, [&](size_t c) {
+		size_t begin = c * chunk;
+		size_t end = std::min(n, begin + chunk);
+		for (size_t s = begin; s < end; s += step) {
+			if (found.load(std::memory_order_relaxed) < s) {
+				return;
+			}
+
+			size_t segEnd = std::min(end, s + step);
+			for (size_t i = s; i < segEnd; i++) {
+				if (pred(first[i])) {
+					size_t cur = found.load();
+					while (i < cur && !found.compare_exchange_weak(cur, i)) {
+					}
+					return;
+				}
+			}
+		}
+		});
+	return first + found.load();
+}
+
+//并行版std::inclusive_scan
+//第一遍各块并行求和，然后在调用线程上求出每块的前缀偏移，第二遍各块带偏移并行扫描
+template<typename Pool, typename InputIt, typename OutputIt, typename BinaryOp = std::plus<>>
+OutputIt parallel_inclusive_scan(Pool& pool, InputIt first, InputIt last, OutputIt dFirst, BinaryOp op = BinaryOp())
+{
+	using T = typename std::iterator_traits<InputIt>::value_type;
+
+	size_t n = (size_t)std::distance(first, last);
+	if (n == 0) {
+		return dFirst;
+	}
+	size_t chunk = parallel_detail::chunkSize(pool.getThreadSize(), n, sizeof(T));
+	size_t count = (n + chunk - 1) / chunk;
+
+	// 第一块在第一遍直接扫描出结果，其余块只求和
+	std::vector<T> sums(count);
+	parallel_detail::runChunks(pool, count, [&](size_t c) {
+		size_t begin = c * chunk;
+		size_t end = std::min(n, begin + chunk);
+		if (c == 0) {
+			std::partial_sum(first, first + end, dFirst, op);
+			sums[0] = dFirst[end - 1];
+			return;
+		}
+		T sum = first[begin];
+		for (size_t i = begin + 1; i < end; i++) {
+			sum = op(sum, first[i]);
+		}
+		sums[c] = sum;
+		});
+
+	if (count == 1) {
+		return dFirst + n;
+	}
+
+	// 块的前缀偏移
+	for (size_t c = 1; c < count; c++) {
+		sums[c] = op(sums[c - 1], sums[c]);
+	}
+
+	parallel_detail::runChunks(pool, count - 1, [&](size_t k) {
+		size_t c = k + 1;
+		size_t begin = c * chunk;
+		size_t end = std::min(n, begin + chunk);
+		T acc = sums[c - 1];
+		for (size_t i = begin; i < end; i++) {
+			acc = op(acc, first[i]);
+			dFirst[i] = acc;
+		}
+		});
+	return dFirst + n;
+}
+
+//并行归并排序(不稳定)
+//先并行地对每块std::sort，然后逐轮两两归并；每次归并再按归并路径切成若干段并行执行，最后几轮也能用满所有线程
+//元素需要可以默认构造和移动赋值，使用与输入等大的临时缓冲区
+template<typename Pool, typename RandomIt, typename Compare = std::less<>>
+void parallel_sort(Pool& pool, RandomIt first, RandomIt last, Compare comp = Compare())
+{
+	using T = typename std::iterator_traits<RandomIt>::value_type;
+
+	size_t n = (size_t)std::distance(first, last);
+	size_t chunk = parallel_detail::chunkSize(pool.getThreadSize(), n, sizeof(T));
+	size_t count = (n + chunk - 1) / chunk;
+	if (count <= 1) {
+		std::sort(first, last, comp);
+		return;
+	}
+
+	parallel_detail::runChunks(pool, count, [&](size_t c) {
+		size_t begin = c * chunk;
+		size_t end = std::min(n, begin + chunk);
+		std::sort(first + begin, first + end, comp);
+		});
+
+	// 在原数组和临时缓冲区之间来回归并
+	std::vector<T> buffer(n);
+	bool inBuffer = false;
+	for (size_t width = chunk; width < n; width *= 2) {
+		if (inBuffer) {
+			parallel_detail::mergeRound(pool, buffer.begin(), first, n, width, chunk, comp);
+		}
+		else {
+			parallel_detail::mergeRound(pool, first, buffer.begin(), n, width, chunk, comp);
+		}
+		inBuffer = !inBuffer;
+	}
+
+	if (inBuffer) {
+		parallel_detail::runChunks(pool, count, [&](size_t c) {
+			size_t begin = c * chunk;
+			size_t end = std::min(n, begin + chunk);
+			std::move(buffer.begin() + begin, buffer.begin() + end, first + begin);
+			});
+	}
+}
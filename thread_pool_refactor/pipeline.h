@@ -0,0 +1,377 @@
+﻿#pragma once
+
+#include <any>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include <thread>
+#include <cstdint>
+
+#include "thread_pool_refactor.h"
+#include "bounded_queue.h"
+
+// 流水线执行器 parse -> transform -> compress -> write 这样的链式处理
+// 相邻阶段之间用有界无锁队列连接，同时在途的数据数量不超过maxTokens(令牌)
+// source每产生一个数据要先拿到一个令牌，数据走完最后一个阶段才归还令牌，下游慢了source自然就停下来，内存占用有上界
+// 串行阶段同一时刻只有一个任务在执行，SERIAL_IN_ORDER阶段按source产生的顺序处理数据，可以用来保证输出有序
+// 所有阶段都运行在ThreadPool的工作线程上，不额外创建线程；线程池队列满了放不下的任务由投递者直接执行
+
+enum StageMode {
+	STAGE_PARALLEL, //多个数据可以同时处理
+	STAGE_SERIAL_IN_ORDER, //一次处理一个，按source产生的顺序
+	STAGE_SERIAL_OUT_OF_ORDER, //一次处理一个，按到达的顺序
+};
+
+// source用来通知流水线数据已经产生完了
+class FlowControl {
+public:
+	FlowControl() : stopped_(false) {}
+
+	//停止产生数据 本次source的返回值会被丢弃
+	void stop() { stopped_ = true; }
+	bool isStopped() const { return stopped_; }
+
+private:
+	bool stopped_;
+};
+
+class Pipeline {
+public:
+	Pipeline(ThreadPool& pool, size_t maxTokens);
+
+	Pipeline(const Pipeline&) = delete;
+	Pipeline& operator=(const Pipeline&) = delete;
+
+	//追加一个阶段 In是该阶段的输入类型 返回值作为下一个阶段的输入
+	//阶段之间的数据保存在std::any中，需要可以拷贝构造
+	template<typename In, typename Func>
+	Pipeline& addStage(StageMode mode, Func func);
+
+	//运行流水线直到source调用FlowControl::stop并且所有数据处理完，阶段抛出的第一个异常会在这里重新抛出
+	//source本身是串行调用的
+	template<typename Func>
+	void run(Func source);
+
+private:
+	// 在阶段之间流动的数据
+	struct Item {
+		uint64_t seq = 0; //source产生的序号
+		bool valid = false; //之前的阶段抛出了异常，数据只占位保证顺序，不再处理
+		std::any value;
+	};
+
+	struct Stage {
+		StageMode mode;
+		std::function<std::any(std::any&)> func;
+		std::unique_ptr<BoundedQueue<Item>> channel; //该阶段的输入队列
+		std::atomic_bool active{ false }; //串行阶段是否已经有drain任务
+		uint64_t nextSeq = 0; //有序阶段下一个要处理的序号
+		std::vector<Item> window; //有序阶段的重排窗口 按seq % maxTokens存放
+		std::vector<char> present; //窗口格子是否有数据
+	};
+
+	template<typename In, typename Func>
+	static std::any invokeStage(Func& func, std::any& value);
+
+	//向线程池投递任务并计数
+	void post(std::function<void()> func);
+
+	//投递的任务执行完毕 最后一个任务唤醒run()
+	void taskDone();
+
+	//把数据交给第index个阶段
+	void deliver(size_t index, Item item);
+
+	//在第index个阶段处理数据
+	void process(size_t index, Item& item);
+
+	//并行阶段 每个任务处理一个数据
+	void runParallel(size_t index);
+
+	//串行阶段 循环处理输入队列中的数据
+	void drainSerial(size_t index);
+
+	//有令牌就继续产生数据
+	void runSource();
+
+	//数据处理完毕 归还令牌
+	void finishItem();
+
+	//记录第一个异常并停止source
+	void fail(std::exception_ptr e);
+
+private:
+	ThreadPool& pool_;
+	size_t maxTokens_; //同时在途的数据上限
+	std::vector<std::unique_ptr<Stage>> stages_;
+
+	std::function<std::any(FlowControl&)> source_;
+	uint64_t produced_; //已经产生的数据数量 只由source访问
+	std::atomic_int tokens_; //剩余令牌
+	std::atomic_bool sourceActive_; //source是否正在运行或者已经结束
+	std::atomic_bool sourceDone_; //source已经结束
+	std::atomic_bool stopRequested_; //有阶段抛出异常 提前结束source
+	std::atomic_int pending_; //已投递但还没执行完的任务数量 减少时持有mtx_
+
+	std::exception_ptr error_; //第一个异常 由mtx_保护
+	std::mutex mtx_;
+	std::condition_variable doneCond_; //等待流水线执行完毕
+};
+
+
+///////////流水线方法实现
+inline Pipeline::Pipeline(ThreadPool& pool, size_t maxTokens)
+	: pool_(pool)
+	, maxTokens_(maxTokens > 0 ? maxTokens : 1)
+	, produced_(0)
+	, tokens_(0)
+	, sourceActive_(false)
+	, sourceDone_(false)
+	, stopRequested_(false)
+	, pending_(0)
+{
+}
+
+template<typename In, typename Func>
+Pipeline& Pipeline::addStage(StageMode mode, Func func)
+{
+	auto stage = std::make_unique<Stage>();
+	stage->mode = mode;
+	stage->func = [func](std::any& value) mutable -> std::any {
+		return invokeStage<In>(func, value);
+	};
+
+	// 在途数据不超过令牌数，队列容量不小于令牌数就不会真正满
+	stage->channel = std::make_unique<BoundedQueue<Item>>(maxTokens_);
+	if (mode == STAGE_SERIAL_IN_ORDER) {
+		stage->window.resize(maxTokens_);
+		stage->present.assign(maxTokens_, 0);
+	}
+
+	stages_.emplace_back(std::move(stage));
+	return *this;
+}
+
+template<typename In, typename Func>
+std::any Pipeline::invokeStage(Func& func, std::any& value)
+{
+	using Out = decltype(func(std::declval<In>()));
+
+	In in = std::any_cast<In>(std::move(value));
+	if constexpr (std::is_void<Out>::value) {
+		func(std::move(in));
+		return std::any();
+	}
+	else {
+		return std::any(func(std::move(in)));
+	}
+}
+
+template<typename Func>
+void Pipeline::run(Func source)
+{
+	source_ = [source](FlowControl& fc) mutable -> std::any { return std::any(source(fc)); };
+
+	produced_ = 0;
+	tokens_ = (int)maxTokens_;
+	sourceActive_ = true;
+	sourceDone_ = false;
+	stopRequested_ = false;
+	error_ = nullptr;
+	for (auto& stage : stages_) {
+		stage->active = false;
+		stage->nextSeq = 0;
+		stage->present.assign(stage->present.size(), 0);
+	}
+
+	post([this]() { runSource(); });
+
+	// source结束并且没有任务在执行，说明所有数据都走完了流水线
+	std::unique_lock<std::mutex> lock(mtx_);
+	doneCond_.wait(lock, [&]()->bool { return sourceDone_ && pending_ == 0; });
+
+	if (error_) {
+		std::rethrow_exception(error_);
+	}
+}
+
+inline void Pipeline::post(std::function<void()> func)
+{
+	pending_++;
+	std::future<void> res = pool_.trySubmitTask([this, func]() {
+		func();
+		taskDone();
+		});
+	if (!res.valid()) {
+		func();
+		taskDone();
+	}
+}
+
+inline void Pipeline::taskDone()
+{
+	// 计数和通知都在锁内完成，run()看到计数为0返回后流水线可能马上析构，解锁之后不能再访问this
+	std::unique_lock<std::mutex> lock(mtx_);
+	if (--pending_ == 0) {
+		doneCond_.notify_all();
+	}
+}
+
+inline void Pipeline::deliver(size_t index, Item item)
+{
+	if (index == stages_.size()) {
+		finishItem();
+		return;
+	}
+
+	Stage& stage = *stages_[index];
+
+	// 在途数据不超过令牌数，但格子里上一轮的数据可能刚被取走、序号还没更新，这时入队会暂时失败，稍等一下即可
+	while (!stage.channel->tryPush(std::move(item))) {
+		std::this_thread::yield();
+	}
+
+	if (stage.mode == STAGE_PARALLEL) {
+		post([this, index]() { runParallel(index); });
+	}
+	else if (!stage.active.exchange(true)) {
+		post([this, index]() { drainSerial(index); });
+	}
+}
+
+inline void Pipeline::process(size_t index, Item& item)
+{
+	if (!item.valid) {
+		return;
+	}
+
+	try {
+		item.value = stages_[index]->func(item.value);
+	}
+	catch (...) {
+		item.valid = false;
+		item.value.reset();
+		fail(std::current_exception());
+	}
+}
+
+inline void Pipeline::runParallel(size_t index)
+{
+	// 每个任务对应一个已经入队的数据，但队列前面的格子可能还没发布完，稍等一下即可
+	Item item;
+	while (!stages_[index]->channel->tryPop(item)) {
+		std::this_thread::yield();
+	}
+
+	process(index, item);
+	deliver(index + 1, std::move(item));
+}
+
+inline void Pipeline::drainSerial(size_t index)
+{
+	Stage& stage = *stages_[index];
+
+	for (;;) {
+		Item item;
+		while (stage.channel->tryPop(item)) {
+			if (stage.mode == STAGE_SERIAL_OUT_OF_ORDER) {
+				process(index, item);
+				deliver(index + 1, std::move(item));
+				continue;
+			}
+
+			// 有序阶段 先放进重排窗口，再把连续的数据依次处理掉
+			size_t slot = (size_t)(item.seq % maxTokens_);
+			stage.window[slot] = std::move(item);
+			stage.present[slot] = 1;
+
+			for (;;) {
+				size_t next = (size_t)(stage.nextSeq % maxTokens_);
+				if (!stage.present[next]) {
+					break;
+				}
+				Item ready = std::move(stage.window[next]);
+				stage.present[next] = 0;
+				stage.nextSeq++;
+
+				process(index, ready);
+				deliver(index + 1, std::move(ready));
+			}
+		}
+
+		// 先放弃执行权再检查队列，生产者要么看到active为false自己投递drain，要么数据已经被这里看到
+		stage.active = false;
+		if (stage.channel->empty() || stage.active.exchange(true)) {
+			return;
+		}
+	}
+}
+
+inline void Pipeline::runSource()
+{
+	for (;;) {
+		while (!stopRequested_) {
+			int tokens = tokens_;
+			if (tokens == 0) {
+				break;
+			}
+			if (!tokens_.compare_exchange_weak(tokens, tokens - 1)) {
+				continue;
+			}
+
+			FlowControl fc;
+			Item item;
+			try {
+				item.value = source_(fc);
+			}
+			catch (...) {
+				fail(std::current_exception());
+				fc.stop();
+			}
+
+			if (fc.isStopped()) {
+				tokens_++;
+				sourceDone_ = true; // sourceActive_保持为true，之后不会再被唤醒
+				return;
+			}
+
+			item.seq = produced_++;
+			item.valid = true;
+			deliver(0, std::move(item));
+		}
+
+		if (stopRequested_) {
+			sourceDone_ = true;
+			return;
+		}
+
+		// 令牌用完了 等下游归还令牌时再唤醒source
+		sourceActive_ = false;
+		if (tokens_ == 0 || sourceActive_.exchange(true)) {
+			return;
+		}
+	}
+}
+
+inline void Pipeline::finishItem()
+{
+	tokens_++;
+	if (!sourceActive_.exchange(true)) {
+		post([this]() { runSource(); });
+	}
+}
+
+inline void Pipeline::fail(std::exception_ptr e)
+{
+	std::unique_lock<std::mutex> lock(mtx_);
+	if (!error_) {
+		error_ = e;
+	}
+	stopRequested_ = true;
+}
@@ -0,0 +1,170 @@
+﻿#pragma once
+
+#include <memory>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+#include <future>
+#include <cstdint>
+
+#include "thread_pool_refactor.h"
+
+// 串行执行器(strand)
+// 投递到同一个Strand的任务按FIFO顺序逐个执行，绝不会并发
+// Strand本身不占用线程：有任务时向底层调度器投递一个drain任务，队列空了就退出
+// Scheduler可以是ThreadPool，也可以是Executor等任何提供trySubmitTask的调度器
+// 调度器的队列满了放不下drain任务时，drain直接在当前线程上执行，不会让任务滞留在strand里
+
+const int STRAND_BATCH_SIZE = 64; // drain任务每次最多连续执行的任务数，超过后重新排队，避免长期霸占工作线程
+
+template<typename Scheduler = ThreadPool>
+class Strand {
+public:
+	explicit Strand(Scheduler& scheduler)
+		: scheduler_(scheduler)
+		, scheduled_(false)
+	{}
+
+	~Strand()
+	{
+		// 等待drain任务退出，drain任务里引用了this
+		std::unique_lock<std::mutex> lock(mtx_);
+		idleCond_.wait(lock, [&]()->bool { return !scheduled_; });
+	}
+
+	Strand(const Strand&) = delete;
+	Strand& operator=(const Strand&) = delete;
+
+	//给strand提交任务
+	template<typename Func, typename... Args>
+	auto submitTask(Func&& func, Args&&... args) -> std::future<decltype(func(args...))>
+	{
+		using Rtype = decltype(func(args...));
+		auto task = std::make_shared<std::packaged_task<Rtype()>>(
+			std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
+
+		std::future<Rtype> result = task->get_future();
+
+		bool needSchedule = false;
+		{
+			std::unique_lock<std::mutex> lock(mtx_);
+			taskQue_.emplace([task]() {(*task)(); });
+
+			// 只有空闲的strand才需要投递drain任务，否则正在运行的drain会顺带执行它
+			if (!scheduled_) {
+				scheduled_ = true;
+				needSchedule = true;
+			}
+		}
+
+		if (needSchedule) {
+			schedule();
+		}
+		return result;
+	}
+
+	//当前排队的任务数量
+	size_t pendingTaskSize() const
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+		return taskQue_.size();
+	}
+
+private:
+	//投递drain任务 调度器放不下时在当前线程上执行
+	void schedule()
+	{
+		if (!scheduler_.trySubmitTask([this]() { drain(); }).valid()) {
+			drain();
+		}
+	}
+
+	//按顺序执行队列中的任务
+	void drain()
+	{
+		for (;;) {
+			for (int i = 0; i < STRAND_BATCH_SIZE; i++) {
+				Task task;
+				{
+					std::unique_lock<std::mutex> lock(mtx_);
+					if (taskQue_.empty()) {
+						scheduled_ = false;
+						idleCond_.notify_all();
+						return;
+					}
+					task = std::move(taskQue_.front());
+					taskQue_.pop();
+				}
+				task(); //执行时不持有锁，任务里可以继续往本strand提交任务
+			}
+
+			// 批次用完还有任务，重新排队让其他任务也有机会执行；调度器放不下就接着执行下一批
+			if (scheduler_.trySubmitTask([this]() { drain(); }).valid()) {
+				return;
+			}
+		}
+	}
+
+private:
+	using Task = std::function<void()>;
+
+	Scheduler& scheduler_;
+	std::queue<Task> taskQue_; //strand的任务队列
+	bool scheduled_; //是否已经有drain任务投递到调度器
+
+	mutable std::mutex mtx_;
+	std::condition_variable idleCond_; //等待drain任务退出
+};
+
+
+// 按key分发任务到strand
+// key通过哈希映射到固定数量的strand上，相同key的任务一定落在同一个strand，保证顺序且不并发
+// 不同key可能共享一个strand（只会多一点串行化，不影响正确性），内存占用与key的数量无关
+template<typename Key, typename Hash = std::hash<Key>, typename Scheduler = ThreadPool>
+class KeyedDispatcher {
+public:
+	KeyedDispatcher(Scheduler& scheduler, size_t strandSize = 1024)
+	{
+		if (strandSize == 0) {
+			strandSize = 1;
+		}
+		strands_.reserve(strandSize);
+		for (size_t i = 0; i < strandSize; i++) {
+			strands_.emplace_back(std::make_unique<Strand<Scheduler>>(scheduler));
+		}
+	}
+
+	KeyedDispatcher(const KeyedDispatcher&) = delete;
+	KeyedDispatcher& operator=(const KeyedDispatcher&) = delete;
+
+	//按key提交任务
+	template<typename Func, typename... Args>
+	auto submitTask(const Key& key, Func&& func, Args&&... args) -> std::future<decltype(func(args...))>
+	{
+		return strandFor(key).submitTask(std::forward<Func>(func), std::forward<Args>(args)...);
+	}
+
+	//获取key对应的strand
+	Strand<Scheduler>& strandFor(const Key& key)
+	{
+		return *strands_[mix(hash_(key)) % strands_.size()];
+	}
+
+private:
+	// std::hash对整数通常是恒等映射，打散一下再取模，避免连续key集中在少数strand上
+	static uint64_t mix(uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+private:
+	Hash hash_;
+	std::vector<std::unique_ptr<Strand<Scheduler>>> strands_;
+};
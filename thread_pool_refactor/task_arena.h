@@ -0,0 +1,327 @@
+﻿#pragma once
+
+#include <memory>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+
+// 任务内存池
+// 线程池通过setTaskArena设置后，提交的任务(绑定后的可调用对象、promise的共享状态)都从这里分配，任务完成后内存回到空闲链表，下一个任务直接复用
+// 按大小分级：64、128、...、4096字节各一个空闲链表，更大的块直接使用operator new
+// 分配发生在提交者线程，释放发生在工作线程或者future析构的线程，每个级别一把锁
+class TaskArena {
+public:
+	static constexpr size_t MIN_BLOCK_SIZE = 64;
+	static constexpr size_t MAX_BLOCK_SIZE = 4096;
+	static constexpr int CLASS_COUNT = 7; // 64 ~ 4096
+
+	//每个级别最多缓存的空闲块数量，超出的块直接还给系统，避免一次流量高峰之后一直占着内存
+	explicit TaskArena(size_t maxCachedBlocks = 1024);
+	~TaskArena();
+
+	TaskArena(const TaskArena&) = delete;
+	TaskArena& operator=(const TaskArena&) = delete;
+
+	//分配/释放 释放时的大小必须与分配时相同
+	void* allocate(size_t bytes);
+	void deallocate(void* p, size_t bytes);
+
+	//正在使用的字节数(按块大小计)
+	size_t getAllocatedBytes() const;
+
+	//空闲链表中缓存的字节数
+	size_t getCachedBytes() const;
+
+private:
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	// 每个级别独占一个缓存行，不同大小的分配互不干扰
+	struct alignas(64) SizeClass {
+		std::mutex mtx;
+		FreeBlock* head = nullptr;
+		size_t count = 0;
+	};
+
+	//大小所属的级别 超过MAX_BLOCK_SIZE返回-1
+	static int classOf(size_t bytes);
+	static size_t blockSize(int index);
+
+private:
+	SizeClass classes_[CLASS_COUNT];
+	size_t maxCachedBlocks_;
+	std::atomic<size_t> allocatedBytes_;
+	std::atomic<size_t> cachedBytes_;
+};
+
+// 从TaskArena分配内存的分配器，可用于std::allocate_shared和std::promise
+// 分配器持有arena的shared_ptr：线程池析构后用户手里的future仍然引用着共享状态，释放时arena必须还在
+template<typename T>
+class ArenaAllocator {
+public:
+	using value_type = T;
+
+	explicit ArenaAllocator(std::shared_ptr<TaskArena> arena) : arena_(std::move(arena)) {}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+	T* allocate(size_t n)
+	{
+		if constexpr (alignof(T) > alignof(std::max_align_t)) {
+			return std::allocator<T>().allocate(n);
+		}
+		else {
+			return static_cast<T*>(arena_->allocate(n * sizeof(T)));
+		}
+	}
+
+	void deallocate(T* p, size_t n)
+	{
+		if constexpr (alignof(T) > alignof(std::max_align_t)) {
+			std::allocator<T>().deallocate(p, n);
+		}
+		else {
+			arena_->deallocate(p, n * sizeof(T));
+		}
+	}
+
+	const std::shared_ptr<TaskArena>& arena() const { return arena_; }
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena_ == other.arena(); }
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena_ != other.arena(); }
+
+private:
+	std::shared_ptr<TaskArena> arena_;
+};
+
+
+// 工作线程的临时内存(bump分配器)
+// 每个工作线程一个，任务执行期间顺序分配，释放什么也不做，任务结束后线程池整体复位
+// 内存块在工作线程上第一次使用时分配，之后一直复用，不会每个任务都malloc/free
+// 任务返回后内存就会被复用，不能把这里分配的内存带出任务(返回值、提交给其他任务等)
+class ScratchArena {
+public:
+	explicit ScratchArena(size_t chunkSize = 64 * 1024);
+
+	ScratchArena(const ScratchArena&) = delete;
+	ScratchArena& operator=(const ScratchArena&) = delete;
+
+	//分配内存 当前块放不下时换下一块
+	void* allocate(size_t bytes, size_t align = alignof(std::max_align_t));
+
+	//复位 所有分配作废，保留常规大小的块，为超大请求单独分配的块释放掉
+	void reset();
+
+	//本次复位以来分配的字节数
+	size_t getUsedBytes() const;
+
+	//持有的内存总量
+	size_t getCapacityBytes() const;
+
+private:
+	struct Chunk {
+		std::unique_ptr<char[]> data;
+		size_t size;
+	};
+
+	std::vector<Chunk> chunks_;
+	size_t chunkSize_; //常规块大小
+	size_t current_; //正在分配的块
+	size_t offset_; //当前块中已经分配的位置
+	size_t used_;
+};
+
+// 从当前工作线程的ScratchArena分配的STL分配器，deallocate什么也不做
+// 例: std::vector<int, ScratchAllocator<int>> v(ScratchAllocator<int>(*ThreadPool::currentScratch()));
+template<typename T>
+class ScratchAllocator {
+public:
+	using value_type = T;
+
+	explicit ScratchAllocator(ScratchArena& arena) : arena_(&arena) {}
+
+	template<typename U>
+	ScratchAllocator(const ScratchAllocator<U>& other) : arena_(&other.arena()) {}
+
+	T* allocate(size_t n) { return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T))); }
+	void deallocate(T*, size_t) {}
+
+	ScratchArena& arena() const { return *arena_; }
+
+	template<typename U>
+	bool operator==(const ScratchAllocator<U>& other) const { return arena_ == &other.arena(); }
+	template<typename U>
+	bool operator!=(const ScratchAllocator<U>& other) const { return arena_ != &other.arena(); }
+
+private:
+	ScratchArena* arena_;
+};
+
+
+///////////////// 任务内存池方法实现
+inline TaskArena::TaskArena(size_t maxCachedBlocks)
+	: maxCachedBlocks_(maxCachedBlocks)
+	, allocatedBytes_(0)
+	, cachedBytes_(0)
+{
+}
+
+inline TaskArena::~TaskArena()
+{
+	for (auto& sc : classes_) {
+		while (sc.head != nullptr) {
+			FreeBlock* block = sc.head;
+			sc.head = block->next;
+			::operator delete(block);
+		}
+	}
+}
+
+inline int TaskArena::classOf(size_t bytes)
+{
+	if (bytes > MAX_BLOCK_SIZE) {
+		return -1;
+	}
+	int index = 0;
+	while (blockSize(index) < bytes) {
+		index++;
+	}
+	return index;
+}
+
+inline size_t TaskArena::blockSize(int index)
+{
+	return MIN_BLOCK_SIZE << index;
+}
+
+inline void* TaskArena::allocate(size_t bytes)
+{
+	int index = classOf(bytes);
+	if (index < 0) {
+		allocatedBytes_.fetch_add(bytes, std::memory_order_relaxed);
+		return ::operator new(bytes);
+	}
+
+	size_t size = blockSize(index);
+	allocatedBytes_.fetch_add(size, std::memory_order_relaxed);
+
+	SizeClass& sc = classes_[index];
+	{
+		std::lock_guard<std::mutex> lock(sc.mtx);
+		if (sc.head != nullptr) {
+			FreeBlock* block = sc.head;
+			sc.head = block->next;
+			sc.count--;
+			cachedBytes_.fetch_sub(size, std::memory_order_relaxed);
+			return block;
+		}
+	}
+	return ::operator new(size);
+}
+
+inline void TaskArena::deallocate(void* p, size_t bytes)
+{
+	int index = classOf(bytes);
+	if (index < 0) {
+		allocatedBytes_.fetch_sub(bytes, std::memory_order_relaxed);
+		::operator delete(p);
+		return;
+	}
+
+	size_t size = blockSize(index);
+	allocatedBytes_.fetch_sub(size, std::memory_order_relaxed);
+
+	SizeClass& sc = classes_[index];
+	{
+		std::lock_guard<std::mutex> lock(sc.mtx);
+		if (sc.count < maxCachedBlocks_) {
+			FreeBlock* block = static_cast<FreeBlock*>(p);
+			block->next = sc.head;
+			sc.head = block;
+			sc.count++;
+			cachedBytes_.fetch_add(size, std::memory_order_relaxed);
+			return;
+		}
+	}
+	::operator delete(p);
+}
+
+inline size_t TaskArena::getAllocatedBytes() const
+{
+	return allocatedBytes_.load(std::memory_order_relaxed);
+}
+
+inline size_t TaskArena::getCachedBytes() const
+{
+	return cachedBytes_.load(std::memory_order_relaxed);
+}
+
+///////////////// 临时内存方法实现
+inline ScratchArena::ScratchArena(size_t chunkSize)
+	: chunkSize_(chunkSize)
+	, current_(0)
+	, offset_(0)
+	, used_(0)
+{
+}
+
+inline void* ScratchArena::allocate(size_t bytes, size_t align)
+{
+	for (;;) {
+		if (current_ < chunks_.size()) {
+			Chunk& chunk = chunks_[current_];
+			uintptr_t base = reinterpret_cast<uintptr_t>(chunk.data.get());
+			size_t start = ((base + offset_ + align - 1) & ~(uintptr_t)(align - 1)) - base;
+			if (start + bytes <= chunk.size) {
+				offset_ = start + bytes;
+				used_ += bytes;
+				return chunk.data.get() + start;
+			}
+			// 后面还有块就换下一块 否则新分配一块
+			if (current_ + 1 < chunks_.size()) {
+				current_++;
+				offset_ = 0;
+				continue;
+			}
+		}
+
+		// 超大请求单独分配一块，大小按对齐留出余量
+		size_t size = std::max(chunkSize_, bytes + align);
+		chunks_.push_back(Chunk{ std::unique_ptr<char[]>(new char[size]), size });
+		current_ = chunks_.size() - 1;
+		offset_ = 0;
+	}
+}
+
+inline void ScratchArena::reset()
+{
+	if (used_ != 0) {
+		chunks_.erase(std::remove_if(chunks_.begin(), chunks_.end(),
+			[&](const Chunk& chunk) { return chunk.size > chunkSize_; }), chunks_.end());
+	}
+	current_ = 0;
+	offset_ = 0;
+	used_ = 0;
+}
+
+inline size_t ScratchArena::getUsedBytes() const
+{
+	return used_;
+}
+
+inline size_t ScratchArena::getCapacityBytes() const
+{
+	size_t total = 0;
+	for (auto& chunk : chunks_) {
+		total += chunk.size;
+	}
+	return total;
+}
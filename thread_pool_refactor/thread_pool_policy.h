@@ -0,0 +1,223 @@
+﻿#pragma once
+
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <type_traits>
+#include <utility>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+
+// 线程池的编译期策略
+// BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize> 在编译期选择：
+//   QueuePolicy     任务队列的实现
+//   WakeupPolicy    提交/取出任务后如何唤醒工作线程
+//   StatsPolicy     是否统计任务数量
+//   TaskStorageSize 任务对象的内联存储大小，0表示使用std::function
+// 不需要的功能不产生任何运行时开销，热路径上的调用都可以被内联
+
+
+/////////////// 任务存储
+
+// 固定大小内联存储的可调用对象，只能移动
+// 不需要像std::function那样要求可拷贝，所以packaged_task可以直接放进来，不用再包一层shared_ptr
+template<size_t Size>
+class InplaceTask {
+public:
+	InplaceTask() : ops_(nullptr) {}
+
+	template<typename Func, typename = typename std::enable_if<!std::is_same<typename std::decay<Func>::type, InplaceTask>::value>::type>
+	InplaceTask(Func&& func)
+	{
+		using F = typename std::decay<Func>::type;
+		static_assert(sizeof(F) <= Size, "task is larger than TaskStorageSize, increase TaskStorageSize");
+		static_assert(alignof(F) <= alignof(std::max_align_t), "task alignment is not supported");
+
+		new (&storage_) F(std::forward<Func>(func));
+		ops_ = &opsFor<F>;
+	}
+
+	InplaceTask(InplaceTask&& other) noexcept
+		: ops_(other.ops_)
+	{
+		if (ops_ != nullptr) {
+			ops_->move(&other.storage_, &storage_);
+			other.reset();
+		}
+	}
+
+	InplaceTask& operator=(InplaceTask&& other) noexcept
+	{
+		if (this != &other) {
+			reset();
+			ops_ = other.ops_;
+			if (ops_ != nullptr) {
+				ops_->move(&other.storage_, &storage_);
+				other.reset();
+			}
+		}
+		return *this;
+	}
+
+	InplaceTask(const InplaceTask&) = delete;
+	InplaceTask& operator=(const InplaceTask&) = delete;
+
+	~InplaceTask() { reset(); }
+
+	void operator()() { ops_->call(&storage_); }
+
+	bool operator==(std::nullptr_t) const { return ops_ == nullptr; }
+	bool operator!=(std::nullptr_t) const { return ops_ != nullptr; }
+
+private:
+	struct Ops {
+		void (*call)(void*);
+		void (*move)(void* from, void* to);
+		void (*destroy)(void*);
+	};
+
+	template<typename F>
+	static constexpr Ops opsFor = {
+		[](void* p) { (*static_cast<F*>(p))(); },
+		[](void* from, void* to) { new (to) F(std::move(*static_cast<F*>(from))); },
+		[](void* p) { static_cast<F*>(p)->~F(); },
+	};
+
+	void reset()
+	{
+		if (ops_ != nullptr) {
+			ops_->destroy(&storage_);
+			ops_ = nullptr;
+		}
+	}
+
+private:
+	typename std::aligned_storage<Size, alignof(std::max_align_t)>::type storage_;
+	const Ops* ops_;
+};
+
+// 按TaskStorageSize选择任务类型
+template<size_t Size>
+struct TaskStorage {
+	using type = InplaceTask<Size>;
+};
+
+template<>
+struct TaskStorage<0> {
+	using type = std::function<void()>;
+};
+
+
+/////////////// 队列策略
+// 队列只在线程池的taskQueMtx_保护下访问，不需要自己加锁
+
+// 默认策略 基于std::deque，容量不限
+struct DequeQueuePolicy {
+	template<typename Task>
+	class Queue {
+	public:
+		static constexpr size_t capacity = SIZE_MAX;
+
+		bool empty() const { return que_.empty(); }
+		size_t size() const { return que_.size(); }
+
+		void push(Task&& task) { que_.emplace_back(std::move(task)); }
+
+		Task pop()
+		{
+			Task task = std::move(que_.front());
+			que_.pop_front();
+			return task;
+		}
+
+	private:
+		std::deque<Task> que_;
+	};
+};
+
+// 固定容量的环形队列 构造时一次性分配，之后提交任务不再为队列分配内存
+// 队列满时提交者和TASK_MAX_THRESHHOLD一样进入等待
+template<size_t Capacity>
+struct RingQueuePolicy {
+	static_assert(Capacity > 0, "ring queue capacity must be positive");
+
+	template<typename Task>
+	class Queue {
+	public:
+		static constexpr size_t capacity = Capacity;
+
+		Queue() : slots_(Capacity), head_(0), size_(0) {}
+
+		bool empty() const { return size_ == 0; }
+		size_t size() const { return size_; }
+
+		void push(Task&& task)
+		{
+			slots_[(head_ + size_) % Capacity] = std::move(task);
+			size_++;
+		}
+
+		Task pop()
+		{
+			Task task = std::move(slots_[head_]);
+			head_ = (head_ + 1) % Capacity;
+			size_--;
+			return task;
+		}
+
+	private:
+		std::vector<Task> slots_;
+		size_t head_;
+		size_t size_;
+	};
+};
+
+
+/////////////// 唤醒策略
+
+// 默认策略 每次提交唤醒所有等待的线程，取走任务后如果还有剩余再唤醒一次
+struct NotifyAllWakeup {
+	static void onSubmit(std::condition_variable& notEmpty) { notEmpty.notify_all(); }
+	static void onRemaining(std::condition_variable& notEmpty) { notEmpty.notify_all(); }
+	static void onDequeue(std::condition_variable& notFull) { notFull.notify_all(); }
+};
+
+// 每个任务只唤醒一个线程，避免惊群；任务和唤醒一一对应，取任务后不需要再通知
+struct NotifyOneWakeup {
+	static void onSubmit(std::condition_variable& notEmpty) { notEmpty.notify_one(); }
+	static void onRemaining(std::condition_variable&) {}
+	static void onDequeue(std::condition_variable& notFull) { notFull.notify_one(); }
+};
+
+
+/////////////// 统计策略
+// 线程池公有继承统计策略，统计接口直接出现在线程池上；钩子函数是protected的，只给线程池调用
+
+// 默认策略 不统计 空基类不占空间，钩子都是空函数
+class NoStats {
+protected:
+	void onSubmit() {}
+	void onReject() {}
+	void onComplete() {}
+};
+
+// 统计已提交、被拒绝、已完成的任务数量
+class CountingStats {
+public:
+	uint64_t getSubmittedTaskCount() const { return submitted_.load(std::memory_order_relaxed); }
+	uint64_t getRejectedTaskCount() const { return rejected_.load(std::memory_order_relaxed); }
+	uint64_t getCompletedTaskCount() const { return completed_.load(std::memory_order_relaxed); }
+
+protected:
+	void onSubmit() { submitted_.fetch_add(1, std::memory_order_relaxed); }
+	void onReject() { rejected_.fetch_add(1, std::memory_order_relaxed); }
+	void onComplete() { completed_.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64_t> submitted_{ 0 };
+	std::atomic<uint64_t> rejected_{ 0 };
+	std::atomic<uint64_t> completed_{ 0 };
+};
@@ -1,16 +1,39 @@
+#pragma once
+
 #include <memory>
 #include <vector>
 #include <iostream>
 #include <functional>
-#include <queue>
 #include <mutex>
-#include <unordered_map>
 #include <future>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <climits>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+
+#include "thread_pool_policy.h"
+#include "task_arena.h"
 
 
 const int TASK_MAX_THRESHHOLD = INT_MAX; // 
 const int THREAD_MAX_THRESHHOLD = 1024; // ߳
 const int THREAD_MAX_IDLE_TIME = 60; // λ
+const size_t TASK_MAX_BYTES_THRESHHOLD = SIZE_MAX; // ֽ
+
+// ̳߳ڲ־ THREAD_POOL_DEBUGĬϲÿstd::cout
+#ifdef THREAD_POOL_DEBUG
+#define POOL_DEBUG_LOG(msg) (std::cout << msg << std::endl)
+#else
+#define POOL_DEBUG_LOG(msg) ((void)0)
+#endif
+
+// ȵ ȷԵȲڰͷļ֮ǰĬʲôҲ
+#ifndef THREAD_POOL_SCHED_POINT
+#define THREAD_POOL_SCHED_POINT() ((void)0)
+#endif
 
 
 enum PoolMode {
@@ -18,12 +41,80 @@ enum PoolMode {
 	MODE_CACHED,
 };
 
+// ̲߳λ״̬
+enum WorkerState {
+	WORKER_RETIRED, //λУû߳ռ
+	WORKER_IDLE, //߳ȡ
+	WORKER_RUNNING, //ִ߳
+	WORKER_PARKED, //߳ϵȴ
+};
+
+// ߳ע
+// ÿ̳߳һ̶Ĳλ飬̱߳žǲλ±꣬0ʼ
+// λ״̬ԭӱ̵߳ӡպͲѯҪȡе
+class WorkerRegistry {
+public:
+	explicit WorkerRegistry(int capacity);
+
+	WorkerRegistry(const WorkerRegistry&) = delete;
+	WorkerRegistry& operator=(const WorkerRegistry&) = delete;
+
+	//ռһвλزλ±꣬ûпвλ-1
+	int claim();
+
+	//ͷŲλ
+	void retire(int threadId);
+
+	//޸/ѯλ״̬
+	void setState(int threadId, WorkerState state);
+	WorkerState getState(int threadId) const;
+
+	//λ
+	int capacity() const;
+
+	//ǰռòλ߳
+	int liveSize() const;
+
+private:
+	// ÿλռһУ֮߳α
+	struct alignas(64) Slot {
+		std::atomic_int state{ WORKER_RETIRED };
+	};
+
+	std::unique_ptr<Slot[]> slots_; //λ
+	int capacity_; //λ
+	std::atomic_int liveSize_; //ռòλ߳
+};
+
+// е promiseͰ󶨺ĿɵöһTaskArenaʱarena
+template<typename Rtype, typename Call>
+struct PromiseCall {
+	std::promise<Rtype> promise;
+	Call call;
+
+	void operator()()
+	{
+		try {
+			if constexpr (std::is_void<Rtype>::value) {
+				call();
+				promise.set_value();
+			}
+			else {
+				promise.set_value(call());
+			}
+		}
+		catch (...) {
+			promise.set_exception(std::current_exception());
+		}
+	}
+};
+
 class Thread {
 public:
 	// ̺߳
 	using ThreadFunc = std::function<void(int)>;
 
-	Thread(ThreadFunc func);
+	Thread(ThreadFunc func, int threadNo);
 
 	~Thread();
 
@@ -34,15 +125,21 @@ public:
 	int getId() const;
 private:
 	ThreadFunc func_;
-	static size_t generateNo_; // ɵ̱߳
-	size_t threadNo_; //̱߳
+	int threadNo_; //̱߳ עеĲλ±
 };
 
 
-class ThreadPool {
+// ̳߳
+// ģǱڲ(thread_pool_policy.h)ĬϲԭΪһ
+// ̳߳ضͷļУԱԴļ
+template<typename QueuePolicy = DequeQueuePolicy,
+	typename WakeupPolicy = NotifyAllWakeup,
+	typename StatsPolicy = NoStats,
+	size_t TaskStorageSize = 0>
+class BasicThreadPool : public StatsPolicy {
 public:
-	ThreadPool();
-	~ThreadPool();
+	BasicThreadPool();
+	~BasicThreadPool();
 
 	void setMode(PoolMode mode);
 
@@ -52,132 +149,250 @@ public:
 	//̳߳cachedģʽֵ
 	void setTaskQueSizeThreshHold(int threshhold);
 
-	//̳߳ύ
+	//еֽ еֽhighWaterύߵȴֱlowWater²Żָύ
+	void setTaskQueBytesThreshHold(size_t highWater);
+	void setTaskQueBytesThreshHold(size_t highWater, size_t lowWater);
+
+	//ֽ
+	size_t getTaskQueBytes() const;
+
+	//ڴ ͷؽĹ״̬arena䣬nullptrָĬϵĶѷ
+	//Ҫύ֮ǰãĬϲʹãarenaÿηͷŶҪֻڷΪƿʱٴ
+	void setTaskArena(std::shared_ptr<TaskArena> arena);
+
+	//̳߳ύ ֽɵö䲶ĲС
 	template<typename Func, typename... Args>
 	auto submitTask(Func&& func, Args&&... args) -> std::future<decltype(func(args...))>
 	{
 		using Rtype = decltype(func(args...));
-		auto task = std::make_shared<std::packaged_task<Rtype()>>(
-			std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
-
-		std::future<Rtype> result = task->get_future();
+		auto call = std::bind(std::forward<Func>(func), std::forward<Args>(args)...);
+		return submitCall<Rtype>(sizeof(PromiseCall<Rtype, decltype(call)>), std::move(call));
+	}
 
-		//ȡ
-		std::unique_lock<std::mutex> lock(taskQueMtx_);
+	//̳߳ύ ɵ߸ռõֽ
+	//ָͨеĴڴsizeof㲻ӦӿڰʵʴС̳߳
+	template<typename Func, typename... Args>
+	auto submitTaskWithBytes(size_t bytes, Func&& func, Args&&... args) -> std::future<decltype(func(args...))>
+	{
+		using Rtype = decltype(func(args...));
+		return submitCall<Rtype>(bytes, std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
+	}
 
-		// ȴһ룬һȻ򷵻ʧ
-		if (!notFull_.wait_for(lock, std::chrono::seconds(1),
-			[&]()->bool { return taskQue_.size() < (size_t)taskQueMaxThreshHold_; })) {
+	//ύ ˲ȴֱӷЧfuture(valid()Ϊfalse)񲻻ִУҲܾ
+	//̳֮߳ϵ(㷨Strand)жǷĽ˶Уȥڵǰִ߳
+	template<typename Func, typename... Args>
+	auto trySubmitTask(Func&& func, Args&&... args) -> std::future<decltype(func(args...))>
+	{
+		using Rtype = decltype(func(args...));
+		auto call = std::bind(std::forward<Func>(func), std::forward<Args>(args)...);
+		return submitCall<Rtype>(sizeof(PromiseCall<Rtype, decltype(call)>), std::move(call), false);
+	}
 
-			std::cerr << "task queue is full!" << std::endl;
-			auto task = std::make_shared<std::packaged_task<Rtype()>> ([]()->Rtype { return Rtype(); });
+	//̳߳ Ĭ4ִ߳
+	void start(int initThreadSize = 4);
 
-			(*task)();
+	//ȡǰ߳
+	int getThreadSize() const;
 
-			return task->get_future();
-		}
+	//̱߳ŵ [0, getWorkerCapacity())֮ڣԤȷÿ̵߳
+	int getWorkerCapacity() const;
 
-		// 񵽶
-		taskQue_.emplace([task]() {(*task)(); });
-		taskSize_++;
+	//ǰ̳߳߳ Ǳ̳߳صĹ߳ʱnullptr
+	static BasicThreadPool* currentPool();
 
-		// ִ֪ͨ߳
-		notEmpty_.notify_all();
+	//ǰ̵߳ı(עλ±) Ǳ̳߳صĹ߳ʱ-1
+	//cachedģʽ̻߳պŻᱻ̸߳
+	static int currentWorkerIndex();
 
-		//CACHEDģʽ ʺϴȽϽ С񣬸ݵǰͿ߳Ƿ񴴽߳
-		if (poolMode_ == PoolMode::MODE_CACHED
-			&& taskSize_ > idleThreadSize_
-			&& curThreadSize_ < threadSizeThreshHold_) {
+	//ǰ̵߳ʱڴ ÿλ Ǳ̳߳صĹ߳ʱnullptr
+	static ScratchArena* currentScratch();
 
-			std::cout << "create new thread..." << std::endl;
+	BasicThreadPool(const BasicThreadPool&) = delete;
+	BasicThreadPool& operator=(const BasicThreadPool&) = delete;
 
-			// ߳
-			auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, this, std::placeholders::_1));
-			size_t threadId = ptr->getId();
-			threads_.emplace(threadId, std::move(ptr));
+private:
+	using Task = typename TaskStorage<TaskStorageSize>::type;
 
-			//߳
-			threads_[threadId]->start();
+	// е ¼ύʱֽȡʱӶֽм
+	struct QueuedTask {
+		Task task;
+		size_t bytes = 0;
+	};
+	using TaskQueue = typename QueuePolicy::template Queue<QueuedTask>;
 
-			//ı̸߳
-			curThreadSize_++;
-			idleThreadSize_++;
-		}
+	//ύ󶨺ò waitΪfalseʱЧfuture
+	template<typename Rtype, typename Call>
+	std::future<Rtype> submitCall(size_t bytes, Call&& call, bool wait = true);
 
-		return result;
-	}
+	//packaged_taskװɶе
+	template<typename Rtype>
+	static Task makeTask(std::packaged_task<Rtype()>&& task);
 
-	//̳߳
-	void start(int initThreadSize);
+	//promiseͿɵöװɶе ڴtaskArena_
+	template<typename Rtype, typename Call>
+	Task makeArenaTask(std::promise<Rtype>&& promise, Call&& call);
 
-	ThreadPool(const ThreadPool&) = delete;
-	ThreadPool& operator=(const ThreadPool&) = delete;
+	//ֽˮλжܷӣҪtaskQueMtx_
+	bool admitBytes(size_t bytes);
 
-private:
 	//̺߳
 	void threadFunc(int threadId);
 
 	//pool״̬
 	bool checkRunnigState() const;
 
+	//cachedģʽһ̣߳߳Ѵ޻ûпвλʱfalse
+	bool addThread();
+
+	//߳˳ ͷŲλ֪ͨܳtaskQueMtx_غٷthis
+	void retireThread(int threadId);
+
+	// ̵߳ ߳ʱã̬ͨӿڲѯ
+	struct WorkerContext {
+		BasicThreadPool* pool = nullptr;
+		int index = -1;
+		ScratchArena* scratch = nullptr;
+	};
+	static thread_local WorkerContext context_;
+
 private:
-	std::unordered_map<int, std::unique_ptr<Thread>> threads_; // ߳б
+	WorkerRegistry workers_; // ߳ע
 
-	int initThreadSize_; //ʼ߳
-	int threadSizeThreshHold_; //ֵ߳
+	std::atomic_int initThreadSize_; //ʼ߳ ߳жǷʱȡ
+	std::atomic_int threadSizeThreshHold_; //ֵ߳ ύʱȡ
 	std::atomic_int curThreadSize_; //¼ǰ̵̳߳߳
 	std::atomic_int idleThreadSize_; // ¼̵߳
 
-	using Task = std::function<void()>;
-	std::queue<Task> taskQue_; //
+	TaskQueue taskQue_; //
 	std::atomic_int taskSize_; //
-	int taskQueMaxThreshHold_; //ֵ
+	std::atomic_int taskQueMaxThreshHold_; //ֵ
+
+	std::atomic<size_t> taskQueBytes_; //еֽ taskQueMtx_޸
+	std::atomic<size_t> taskQueBytesHighWater_; //ֽ ͣύ
+	std::atomic<size_t> taskQueBytesLowWater_; //ͣύ ֽŻָ
+	bool bytesThrottled_; //Ƿͣύ״̬ taskQueMtx_·
+
+	std::shared_ptr<TaskArena> taskArena_; //ڴ ĬΪ futureܱ̳߳ػþãԹ
 
 	std::mutex taskQueMtx_; //֤е̰߳ȫ
 	std::condition_variable notFull_; //ʾв
 	std::condition_variable notEmpty_; //ʾв
+	std::mutex exitMtx_; //߳˳֮ͬ ޹
 	std::condition_variable exitCond_; //ȵ߳Դȫ
 
-	PoolMode poolMode_; //ǰ̳߳صĹģʽ
+	std::atomic<PoolMode> poolMode_; //ǰ̳߳صĹģʽ ߳ʱҲȡ
 	std::atomic_bool isPoolRunning_; //ʾǰ̳߳״̬
 };
 
+// ĬϲԵ̳߳
+using ThreadPool = BasicThreadPool<>;
+
 
 ///////////̳߳طʵ
-ThreadPool::ThreadPool()
-	: initThreadSize_(0)
-	, taskSize_(0)
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+thread_local typename BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::WorkerContext
+BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::context_;
+
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::BasicThreadPool()
+	: workers_(THREAD_MAX_THRESHHOLD)
+	, initThreadSize_(0)
+	, threadSizeThreshHold_(THREAD_MAX_THRESHHOLD)
+	, curThreadSize_(0)
 	, idleThreadSize_(0)
-	, isPoolRunning_(false)
+	, taskSize_(0)
 	, taskQueMaxThreshHold_(TASK_MAX_THRESHHOLD)
-	, threadSizeThreshHold_(THREAD_MAX_THRESHHOLD)
+	, taskQueBytes_(0)
+	, taskQueBytesHighWater_(TASK_MAX_BYTES_THRESHHOLD)
+	, taskQueBytesLowWater_(TASK_MAX_BYTES_THRESHHOLD)
+	, bytesThrottled_(false)
+	, taskArena_(nullptr)
 	, poolMode_(PoolMode::MODE_FIXED)
+	, isPoolRunning_(false)
 {
 }
 
-ThreadPool::~ThreadPool() {
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::~BasicThreadPool() {
 	isPoolRunning_ = false;
 
 	// ȴִ̳߳߳Ϸأܴ߳̿2״̬ 1:  2: ִ
-	std::unique_lock<std::mutex> lock(taskQueMtx_);
-	notEmpty_.notify_all();
-	exitCond_.wait(lock, [&]()->bool { return threads_.size() == 0; });
+	{
+		std::unique_lock<std::mutex> lock(taskQueMtx_);
+		notEmpty_.notify_all();
+	}
+	std::unique_lock<std::mutex> lock(exitMtx_);
+	exitCond_.wait(lock, [&]()->bool { return workers_.liveSize() == 0; });
 }
 
 // ̳߳صĹģʽ
-void ThreadPool::setMode(PoolMode mode)
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+void BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::setMode(PoolMode mode)
 {
 	poolMode_ = mode;
 }
 
 // taskֵ
-void ThreadPool::setTaskQueMaxThreshHold(int threshhold)
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+void BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::setTaskQueMaxThreshHold(int threshhold)
 {
 	taskQueMaxThreshHold_ = threshhold;
 }
 
+// ֽ ָߵˮλ
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+void BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::setTaskQueBytesThreshHold(size_t highWater)
+{
+	setTaskQueBytesThreshHold(highWater, highWater);
+}
+
+// ֽĸߵˮλ
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+void BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::setTaskQueBytesThreshHold(size_t highWater, size_t lowWater)
+{
+	std::unique_lock<std::mutex> lock(taskQueMtx_);
+	taskQueBytesHighWater_ = highWater;
+	taskQueBytesLowWater_ = std::min(lowWater, highWater);
+	bytesThrottled_ = false;
+
+	// ˮλܵ õȴеύж
+	notFull_.notify_all();
+}
+
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+size_t BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::getTaskQueBytes() const
+{
+	return taskQueBytes_;
+}
+
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+void BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::setTaskArena(std::shared_ptr<TaskArena> arena)
+{
+	taskArena_ = std::move(arena);
+}
+
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+bool BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::admitBytes(size_t bytes)
+{
+	// ͣύҪֽˮλ£ڸˮλͣ/ָ
+	if (bytesThrottled_) {
+		if (taskQueBytes_ > taskQueBytesLowWater_) {
+			return false;
+		}
+		bytesThrottled_ = false;
+	}
+
+	// Ϊʱӣ򵥸޵Զύ
+	if (taskQueBytes_ != 0 && taskQueBytes_ + bytes > taskQueBytesHighWater_) {
+		bytesThrottled_ = true;
+		return false;
+	}
+	return true;
+}
+
 // ̳߳cachedģʽֵ߳
-void ThreadPool::setTaskQueSizeThreshHold(int threshhold)
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+void BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::setTaskQueSizeThreshHold(int threshhold)
 {
 	if (poolMode_ == PoolMode::MODE_CACHED) {
 		threadSizeThreshHold_ = threshhold;
@@ -185,7 +400,8 @@ void ThreadPool::setTaskQueSizeThreshHold(int threshhold)
 }
 
 //̳߳ؿʼִ
-void ThreadPool::start(int initThreadSize = 4) //Ĭ4ִ߳
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+void BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::start(int initThreadSize)
 {
 	// ¼ʼ̸߳
 	initThreadSize_ = initThreadSize;
@@ -194,49 +410,87 @@ void ThreadPool::start(int initThreadSize = 4) //Ĭ
 	// ̳߳״̬
 	isPoolRunning_ = true;
 
-	// ̶߳
-	for (int i = 0; i < initThreadSize_; i++) {
-		auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, this, std::placeholders::_1));
-		//auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, std::placeholders::_1, this));
-
-		int threadId = ptr->getId();
-		threads_.emplace(threadId, std::move(ptr));
+	// ̱߳߳žעĲλ±
+	for (int i = 0; i < initThreadSize; i++) {
+		int threadId = workers_.claim();
+		if (threadId < 0) {
+			curThreadSize_--;
+			continue;
+		}
 
+		idleThreadSize_++; // ¼߳
+		Thread(std::bind(&BasicThreadPool::threadFunc, this, std::placeholders::_1), threadId).start(); // һ߳
 	}
+}
 
-	// ߳
-	for (int i = 0; i < initThreadSize_; i++)
-	{
-		threads_[i]->start(); // һ߳
-		idleThreadSize_++; // ¼߳
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+bool BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::addThread()
+{
+	// ռס߳֤ύʱᳬ
+	int cur = curThreadSize_;
+	do {
+		if (cur >= threadSizeThreshHold_) {
+			return false;
+		}
+	} while (!curThreadSize_.compare_exchange_weak(cur, cur + 1));
+
+	int threadId = workers_.claim();
+	if (threadId < 0) {
+		curThreadSize_--;
+		return false;
 	}
+
+	POOL_DEBUG_LOG("create new thread...");
+
+	//ı̸߳
+	idleThreadSize_++;
+
+	//߳
+	Thread(std::bind(&BasicThreadPool::threadFunc, this, std::placeholders::_1), threadId).start();
+	return true;
+}
+
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+void BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::retireThread(int threadId)
+{
+	// ͷŲλ֪ͨexitMtx_ɣҪõexitMtx_ܿ߳Ϊ0
+	// ֪ͨҲ֮ǰ̳߳
+	std::lock_guard<std::mutex> lock(exitMtx_);
+	workers_.retire(threadId);
+	exitCond_.notify_all();
 }
 
 //߳ں
-void ThreadPool::threadFunc(int threadId)
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+void BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::threadFunc(int threadId)
 {
 	auto lastTime = std::chrono::high_resolution_clock().now();
 
+	// ʱڴ߳Լ߳ϵһʹʱŷ
+	ScratchArena scratch;
+	context_ = WorkerContext{ this, threadId, &scratch };
+
 	for (;;) {
-		Task task;
+		QueuedTask task;
 		{
 			std::unique_lock<std::mutex> lock(taskQueMtx_);
+			workers_.setState(threadId, WORKER_IDLE);
 
-			std::cout << "tid " << std::this_thread::get_id()
-				<< "Իȡ " << std::endl;
+			POOL_DEBUG_LOG("tid " << std::this_thread::get_id() << "Իȡ ");
 
 			// +˫ж
-			while (taskQue_.size() == 0) {
+			while (taskQue_.empty()) {
 
 				//̳߳ǷѾر
 				if (!isPoolRunning_) {
-					threads_.erase(threadId);
-
-					std::cout << "thread_id " << std::this_thread::get_id() << "exit!" << std::endl;
-					exitCond_.notify_all();
+					POOL_DEBUG_LOG("thread_id " << std::this_thread::get_id() << "exit!");
+					lock.unlock();
+					retireThread(threadId);
 					return; // ̺߳߳̽
 				}
 
+				workers_.setState(threadId, WORKER_PARKED);
+
 				// Cachedģʽ 
 				if (poolMode_ == MODE_CACHED) {
 
@@ -248,11 +502,12 @@ void ThreadPool::threadFunc(int threadId)
 						if (dur.count() >= THREAD_MAX_IDLE_TIME
 							&& curThreadSize_ > initThreadSize_) {
 
-							threads_.erase(threadId);
 							curThreadSize_--;
 							idleThreadSize_--;
 
-							std::cout << "thread_id " << std::this_thread::get_id() << "exit!" << std::endl;
+							POOL_DEBUG_LOG("thread_id " << std::this_thread::get_id() << "exit!");
+							lock.unlock();
+							retireThread(threadId);
 							return;
 						}
 					}
@@ -261,29 +516,38 @@ void ThreadPool::threadFunc(int threadId)
 				else {
 					notEmpty_.wait(lock);
 				}
+				workers_.setState(threadId, WORKER_IDLE);
 			}
 			idleThreadSize_--;
+			workers_.setState(threadId, WORKER_RUNNING);
 
-			std::cout << "tid " << std::this_thread::get_id() << "ȡɹ "
-				<< std::endl;
+			POOL_DEBUG_LOG("tid " << std::this_thread::get_id() << "ȡɹ ");
 
 			//ȡһִ
-			task = taskQue_.front();
-			taskQue_.pop();
+			task = taskQue_.pop();
 			taskSize_--;
+			taskQueBytes_ -= task.bytes;
+
+			// ˮλ ָеȴύ
+			if (bytesThrottled_ && taskQueBytes_ <= taskQueBytesLowWater_) {
+				notFull_.notify_all();
+			}
 
 			// ʣִ֪ͨ߳̿
-			if (taskQue_.size() > 0) {
-				notEmpty_.notify_all();
+			if (!taskQue_.empty()) {
+				WakeupPolicy::onRemaining(notEmpty_);
 			}
 
 			// ȡһ񣬽֪֪ͨͨԼ
-			notFull_.notify_all();
+			WakeupPolicy::onDequeue(notFull_);
 		} //  Զ
 
-		if (task != nullptr) {
-			task(); //ִύ
+		if (task.task != nullptr) {
+			task.task(); //ִύ
+			this->onComplete();
 		}
+		task.task = Task(); // ִͷŲ
+		scratch.reset();
 
 		idleThreadSize_++;
 		lastTime = std::chrono::high_resolution_clock().now(); //ִ߳ʱ
@@ -291,25 +555,202 @@ void ThreadPool::threadFunc(int threadId)
 	}
 }
 
-bool ThreadPool::checkRunnigState() const
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+int BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::getThreadSize() const
+{
+	return curThreadSize_;
+}
+
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+int BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::getWorkerCapacity() const
+{
+	return workers_.capacity();
+}
+
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>* BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::currentPool()
+{
+	return context_.pool;
+}
+
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+int BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::currentWorkerIndex()
+{
+	return context_.index;
+}
+
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+ScratchArena* BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::currentScratch()
+{
+	return context_.scratch;
+}
+
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+bool BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::checkRunnigState() const
 {
 	return isPoolRunning_;
 }
 
-///////////////// ̷߳ʵ
-size_t Thread::generateNo_ = 0;
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+template<typename Rtype, typename Call>
+std::future<Rtype> BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::submitCall(size_t bytes, Call&& call, bool wait)
+{
+	// װ
+	std::future<Rtype> result;
+	Task queued;
+	if (taskArena_ != nullptr) {
+		// promiseĹ״̬TaskArena䣬ɡfutureͷźڴصarena
+		std::promise<Rtype> promise(std::allocator_arg, ArenaAllocator<char>(taskArena_));
+		result = promise.get_future();
+		queued = makeArenaTask(std::move(promise), std::forward<Call>(call));
+	}
+	else {
+		std::packaged_task<Rtype()> task(std::forward<Call>(call));
+		result = task.get_future();
+		queued = makeTask(std::move(task));
+	}
+
+	//ȡ
+	std::unique_lock<std::mutex> lock(taskQueMtx_);
+
+	auto canPush = [&]()->bool {
+		return taskQue_.size() < (size_t)taskQueMaxThreshHold_ && taskQue_.size() < TaskQueue::capacity && admitBytes(bytes);
+	};
 
-Thread::Thread(ThreadFunc func)
+	// ȴ ˶о͸ߵ
+	if (!wait && !canPush()) {
+		return std::future<Rtype>();
+	}
+
+	// ȴһ룬һȻ򷵻ʧ
+	if (!notFull_.wait_for(lock, std::chrono::seconds(1), canPush)) {
+
+		std::cerr << "task queue is full!" << std::endl;
+		this->onReject();
+		auto task = std::make_shared<std::packaged_task<Rtype()>> ([]()->Rtype { return Rtype(); });
+
+		(*task)();
+
+		return task->get_future();
+	}
+
+	// 񵽶
+	taskQue_.push(QueuedTask{ std::move(queued), bytes });
+	taskSize_++;
+	taskQueBytes_ += bytes;
+	this->onSubmit();
+
+	// ִ֪ͨ߳
+	WakeupPolicy::onSubmit(notEmpty_);
+
+	// ֻ߳漰עԭӼҪе
+	lock.unlock();
+
+	//CACHEDģʽ ʺϴȽϽ С񣬸ݵǰͿ߳Ƿ񴴽߳
+	if (poolMode_ == PoolMode::MODE_CACHED
+		&& taskSize_ > idleThreadSize_) {
+		addThread();
+	}
+
+	return result;
+}
+
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+template<typename Rtype>
+typename BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::Task BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::makeTask(std::packaged_task<Rtype()>&& task)
+{
+	if constexpr (TaskStorageSize == 0) {
+		// std::functionҪɿpackaged_taskֻƶһshared_ptr
+		auto sp = std::make_shared<std::packaged_task<Rtype()>>(std::move(task));
+		return Task([sp]() {(*sp)(); });
+	}
+	else {
+		// 洢ֱӷpackaged_taskʡһζѷ
+		return Task([task = std::move(task)]() mutable { task(); });
+	}
+}
+
+template<typename QueuePolicy, typename WakeupPolicy, typename StatsPolicy, size_t TaskStorageSize>
+template<typename Rtype, typename Call>
+typename BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::Task BasicThreadPool<QueuePolicy, WakeupPolicy, StatsPolicy, TaskStorageSize>::makeArenaTask(std::promise<Rtype>&& promise, Call&& call)
+{
+	using Node = PromiseCall<Rtype, typename std::decay<Call>::type>;
+
+	if constexpr (TaskStorageSize != 0 && sizeof(Node) <= TaskStorageSize && alignof(Node) <= alignof(std::max_align_t)) {
+		// 洢ŵ¾ֱӷڶҪٷ
+		return Task(Node{ std::move(promise), std::forward<Call>(call) });
+	}
+	else {
+		// Ų»ʹstd::function(Ҫɿ)ʱŵarenaУֻshared_ptr
+		// 洢shared_ptrŲʱĬ·һڱڱ
+		auto sp = std::allocate_shared<Node>(ArenaAllocator<Node>(taskArena_), Node{ std::move(promise), std::forward<Call>(call) });
+		return Task([sp]() {(*sp)(); });
+	}
+}
+
+///////////////// ߳עʵ
+inline WorkerRegistry::WorkerRegistry(int capacity)
+	: slots_(new Slot[capacity])
+	, capacity_(capacity)
+	, liveSize_(0)
+{
+}
+
+inline int WorkerRegistry::claim()
+{
+	for (int i = 0; i < capacity_; i++) {
+		int expected = WORKER_RETIRED;
+		if (slots_[i].state.load(std::memory_order_relaxed) != WORKER_RETIRED) {
+			continue;
+		}
+		THREAD_POOL_SCHED_POINT();
+		if (slots_[i].state.compare_exchange_strong(expected, WORKER_IDLE)) {
+			THREAD_POOL_SCHED_POINT();
+			liveSize_++;
+			return i;
+		}
+	}
+	return -1;
+}
+
+inline void WorkerRegistry::retire(int threadId)
+{
+	slots_[threadId].state = WORKER_RETIRED;
+	liveSize_--;
+}
+
+inline void WorkerRegistry::setState(int threadId, WorkerState state)
+{
+	slots_[threadId].state.store(state, std::memory_order_relaxed);
+}
+
+inline WorkerState WorkerRegistry::getState(int threadId) const
+{
+	return (WorkerState)slots_[threadId].state.load(std::memory_order_relaxed);
+}
+
+inline int WorkerRegistry::capacity() const
+{
+	return capacity_;
+}
+
+inline int WorkerRegistry::liveSize() const
+{
+	return liveSize_;
+}
+
+///////////////// ̷߳ʵ
+inline Thread::Thread(ThreadFunc func, int threadNo)
 	: func_(func)
-	, threadNo_(generateNo_++)
+	, threadNo_(threadNo)
 {
 }
 
-Thread::~Thread()
+inline Thread::~Thread()
 {
 }
 
-void Thread::start()
+inline void Thread::start()
 {
 	// һִ߳ȥִfunc_
 	std::thread t(func_, threadNo_);
@@ -317,7 +758,7 @@ void Thread::start()
 	t.detach();
 }
 
-int Thread::getId() const
+inline int Thread::getId() const
 {
 	return threadNo_;
 }
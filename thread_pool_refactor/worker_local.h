@@ -0,0 +1,79 @@
+﻿#pragma once
+
+#include <memory>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <functional>
+
+#include "thread_pool_refactor.h"
+
+// 每个工作线程一份的用户数据
+// 按注册表槽位下标索引，对象在工作线程第一次访问时由该线程构造，之后同一线程上的任务直接复用，访问不需要加锁
+// 不是该线程池工作线程的调用者(例如提交任务的线程)各自有一份单独的对象
+// cached模式下线程回收后槽位被新线程复用，对象也随槽位沿用
+template<typename T, typename Pool = ThreadPool>
+class WorkerLocal {
+public:
+	explicit WorkerLocal(Pool& pool, std::function<T()> init = []() { return T(); })
+		: pool_(pool)
+		, init_(std::move(init))
+		, slots_(pool.getWorkerCapacity())
+	{}
+
+	WorkerLocal(const WorkerLocal&) = delete;
+	WorkerLocal& operator=(const WorkerLocal&) = delete;
+
+	//当前线程的对象 第一次访问时构造
+	T& local()
+	{
+		if (Pool::currentPool() == &pool_) {
+			std::unique_ptr<T>& slot = slots_[Pool::currentWorkerIndex()];
+			if (slot == nullptr) {
+				slot.reset(new T(init_()));
+			}
+			return *slot;
+		}
+
+		std::unique_lock<std::mutex> lock(externalMtx_);
+		std::unique_ptr<T>& slot = external_[std::this_thread::get_id()];
+		if (slot == nullptr) {
+			slot.reset(new T(init_()));
+		}
+		return *slot;
+	}
+
+	//遍历所有已经构造的对象，用来合并各线程的结果
+	//调用时不能有任务正在访问local()，通常在等待所有任务的future之后调用
+	template<typename Func>
+	void forEach(Func func)
+	{
+		for (auto& slot : slots_) {
+			if (slot != nullptr) {
+				func(*slot);
+			}
+		}
+		std::unique_lock<std::mutex> lock(externalMtx_);
+		for (auto& item : external_) {
+			func(*item.second);
+		}
+	}
+
+	//销毁所有对象 下次访问时重新构造，调用要求与forEach相同
+	void clear()
+	{
+		for (auto& slot : slots_) {
+			slot.reset();
+		}
+		std::unique_lock<std::mutex> lock(externalMtx_);
+		external_.clear();
+	}
+
+private:
+	Pool& pool_;
+	std::function<T()> init_; //构造每个线程的对象
+	std::vector<std::unique_ptr<T>> slots_; //工作线程的对象 下标是槽位下标，只有占用该槽位的线程会写
+	std::mutex externalMtx_;
+	std::map<std::thread::id, std::unique_ptr<T>> external_; //非工作线程的对象
+};